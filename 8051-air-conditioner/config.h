@@ -0,0 +1,29 @@
+//-----------------------------------------------------------------------------
+// config.h
+//-----------------------------------------------------------------------------
+//
+// Settings for the modules in common/, as built into the A/C control unit.
+// The build puts this directory on the include path ahead of common/.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Every sensor node and the thermostat can report at once, so the receive
+// ring holds a burst of a dozen frames
+#define UART_RX_RINGSIZE  256
+
+// TASK_FRAME in control-unit.c, signalled by UART1_Interrupt for every byte
+// received
+#define UART_RX_TASK      0
+
+// Escaped API mode; see XBEE_TX_WORST in xbee.h for why and for the slot size
+#define XBEE_AP            2
+#define UART_TX_FRAMESIZE  26
+
+#endif                                 // CONFIG_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -38,75 +38,154 @@
 //
 // 2) SiLabs example code found in F02x_UART1_Interrupt in C:\SiLabs\MCU\Examples\C8051F02x\UART folder
 //		UART programming and UART interrupt examples, which we heavily modified but still relied on
+//
+// Build notes: SFRs, bits and interrupts are declared through the SiLabs
+// compiler_defs.h / C8051F020_defs.h macros, so the same source builds with
+// SDCC as well as Keil C51. SDCC has no code-size limit, which is what lets
+// the control unit keep separate Rx and Tx buffers.
 
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
 
-#include <c8051f020.h>                 // SFR declarations
+#include <compiler_defs.h>
+#include <C8051F020_defs.h>            // SFR declarations
 #include <stdio.h>
+#include "config.h"                    // Settings for the common modules
+#include "clock.h"                     // Crystal oscillator and SYSCLK
+#include "uart.h"                      // UART1 link to the XBee
+#include "xbee.h"                      // XBee API framing
+#include "timer.h"                     // System tick and software timers
+#include "sched.h"                     // Cooperative task scheduler
+#include "nodes.h"                     // Per-source sensor table
+#include "filter.h"                    // Moving-average filter
 
 //-----------------------------------------------------------------------------
-// 16-bit SFR Definitions for 'F02x
+// Function Prototypes
 //-----------------------------------------------------------------------------
 
-sfr16 RCAP2    = 0xca;                 // Timer2 capture/reload
-sfr16 TMR2     = 0xcc;                 // Timer2
+void PORT_Init (void);
+void PCA0_Init (void);
+void DHT11_Start (void);
+void GetInternalReadings ();
+INTERRUPT_PROTO (PCA0_ISR, INTERRUPT_PCA0);
+void Set_LEDs ();
+void Display_Temp (short measurement, short output);
+void Display_Digit (unsigned char digit, unsigned char latch);
+unsigned char TransmitData (short avgTemp, char state);
+
+void Frame_Task (void);
+void Sensor_Task (void);
+void Control_Task (void);
+void Display_Task (void);
+void LED_Task (void);
+void Node_Task (void);
 
 //-----------------------------------------------------------------------------
-// Global Constants
+// Global Variables
 //-----------------------------------------------------------------------------
 
-#define BAUDRATE     9600            // Baud rate of UART in bps
+unsigned char dht11_dat[5] = { 0, 0, 0, 0, 0 };
+// Coolant temp in tenths of a degree F, 0 until the first good read. Kept in
+// fixed point so nothing in this image needs the floating point library.
+signed int internal_temp = 0;
 
-// SYSTEMCLOCK = System clock frequency in Hz
+#define TENTHS(deg)    ((deg) * 10)
 
-#define SYSTEMCLOCK       (22118400L)
+// DHT11 decoder, see DHT11_Start and PCA0_ISR. The PCA counts SYSCLK/12.
+#define DHT11_IDLE     0               // no read in progress
+#define DHT11_START    1               // holding the line low
+#define DHT11_RECEIVE  2               // timestamping falling edges
+#define DHT11_DONE     3               // all 40 bits in dht11_dat
+#define DHT11_TIMEOUT  4               // sensor stopped answering
 
-//-----------------------------------------------------------------------------
-// Function Prototypes
-//-----------------------------------------------------------------------------
+#define DHT11_START_COUNTS    ((SYSCLK/12*18 + 999)/1000) // >= 18 ms start
+#define DHT11_TIMEOUT_COUNTS  (SYSCLK/12/1000*10)   // 10 ms to send 40 bits
+#define DHT11_ONE_COUNTS      (SYSCLK/12/10000)     // 100 us bit period
+#define DHT11_EDGES           42       // response, 40 bits, end of frame
 
-void OSCILLATOR_Init (void);
-void PORT_Init (void);
-void UART1_Init (void);
-void GetInternalReadings ();
-void Wait_MS (unsigned int ms);
-void Wait_uS (unsigned int us);
-void Set_LEDs ();
-void Display_Temp (float measurement, short output);
-void Display_Digit (short digit, short latch);
-void TransmitData (short avgTemp, char state);
+volatile unsigned char DHT11_State = DHT11_IDLE;
+unsigned char DHT11_Edges = 0;         // falling edges seen (ISR only)
+unsigned int DHT11_Last = 0;           // PCA time of the last edge (ISR only)
+unsigned char DHT11_Checksum_Errors = 0;
+unsigned char DHT11_Timeouts = 0;
+
+// Control state shared by the tasks below
+unsigned short AVG_Temp = 0;           // smoothed average of the live nodes
+Filter_MA SEG_XDATA AVG_Filter;        // smooths nodes joining and leaving
+unsigned short SET_Temp = 0;
+unsigned short Shown_AVG_Temp = 0xFFFF; // what the 7-seg displays show now
+unsigned short Shown_SET_Temp = 0xFFFF;
+unsigned char State = 0x00;
+bit IsOn = 0;
 
 //-----------------------------------------------------------------------------
-// Global Variables
+// Tasks
+//-----------------------------------------------------------------------------
+//
+// Work that used to be multiplexed through a loop counter is split into
+// tasks. The frame task is signalled by the UART1 interrupt for every byte
+// received, so frames are handled as soon as they arrive. The rest run on
+// the periods the old counter gave them. The node task ages out sensors that
+// have gone quiet.
+//
 //-----------------------------------------------------------------------------
 
-#define UART_BUFFERSIZE 24
-unsigned char UART_Buffer[UART_BUFFERSIZE];
-unsigned char UART_Buffer_Size = 0;
-unsigned char UART_Input_First = 0;
-unsigned char UART_Output_First = 0;
-unsigned char TX_Ready = 1;
-static char Byte;
-unsigned int dht11_dat[5] = { 0, 0, 0, 0, 0 };
-float internal_temp = 0.0;
+#define TASK_FRAME     UART_RX_TASK    // see config.h
+#define TASK_SENSOR    1
+#define TASK_CONTROL   2
+#define TASK_DISPLAY   3
+#define TASK_LEDS      4
+#define TASK_NODES     5
+#define TASK_COUNT     6
+
+Sched_Task SEG_XDATA Tasks[TASK_COUNT] =
+{
+   // run              period   phase  prio  budget (ms)
+   { Frame_Task,         0,      0,     0,    5 },
+   { Sensor_Task,    10000,      0,     1,    1 },
+   { Control_Task,    5000,      0,     2,    1 },
+   { Display_Task,       0,      0,     3,    1 },
+   { LED_Task,        1000,      0,     4,    1 },
+   { Node_Task,       1000,    500,     5,    1 },
+};
 
 //-----------------------------------------------------------------------------
 // DHT11
 //-----------------------------------------------------------------------------
-sbit DHT11 = P1^4;
-sbit RELAY = P1^2;
-
-sbit LATCH0    = P2^0; // latches
-sbit LATCH1    = P2^2;
-sbit LATCH2    = P2^4;
-sbit LATCH4    = P2^6;
-
-sbit DIGIT1    = P2^1; // digits
-sbit DIGIT2    = P2^3;
-sbit DIGIT4    = P2^5;
-sbit DIGIT8    = P2^7;
+// The DHT11 data line is on P0.4, which the crossbar gives to PCA0 CEX0 (the
+// next free pin after UART0 and UART1). It used to be on P1.4, so older
+// boards need the wire moved; see the README.
+SBIT (RELAY, SFR_P1, 2);
+
+// 7-segment bus: the latch enables of the four CD4543Bs and their shared BCD
+// inputs. With DISPLAY_PORT defined, Display_Digit drives them with three
+// whole-port writes built from the bit masks below. Leave it undefined on a
+// board where they are spread over several ports, and the sbits are written
+// one at a time instead, in the same order.
+#define DISPLAY_PORT   P2
+
+#define DISPLAY_LATCH0 0x01
+#define DISPLAY_LATCH1 0x04
+#define DISPLAY_LATCH2 0x10
+#define DISPLAY_LATCH3 0x40
+#define DISPLAY_BCD1   0x02
+#define DISPLAY_BCD2   0x08
+#define DISPLAY_BCD4   0x20
+#define DISPLAY_BCD8   0x80
+#define DISPLAY_MASK   (DISPLAY_LATCH0 | DISPLAY_LATCH1 | DISPLAY_LATCH2 | \
+                        DISPLAY_LATCH3 | DISPLAY_BCD1 | DISPLAY_BCD2 | \
+                        DISPLAY_BCD4 | DISPLAY_BCD8)
+
+SBIT (LATCH0, SFR_P2, 0); // latches
+SBIT (LATCH1, SFR_P2, 2);
+SBIT (LATCH2, SFR_P2, 4);
+SBIT (LATCH4, SFR_P2, 6);
+
+SBIT (DIGIT1, SFR_P2, 1); // digits
+SBIT (DIGIT2, SFR_P2, 3);
+SBIT (DIGIT4, SFR_P2, 5);
+SBIT (DIGIT8, SFR_P2, 7);
 
 //-----------------------------------------------------------------------------
 // main() Routine
@@ -114,28 +193,19 @@ sbit DIGIT8    = P2^7;
 
 void main (void)
 {
-	unsigned short AVG_Temps[7] = {0,0,0,0,0,0,0};
-	unsigned short AVG_Temp = 0;
-	unsigned short SET_Temp = 0;
-
-	unsigned short PREV_SET_Temp = 0;
-	unsigned short PREV_AVG_Temp = 0;
-
-	bit first = 1;
-	bit isOn = 0;
-
-	int i = 0;
-	int j = 0;
-
-	unsigned short state = 0x00;
-
    WDTCN = 0xDE;                       // Disable watchdog timer
    WDTCN = 0xAD;
 
-   OSCILLATOR_Init ();                 // Initialize oscillator
+   // What does not depend on SYSCLK is done while the crystal settles
+   OSCILLATOR_Start ();                // Start the crystal
    PORT_Init ();                       // Initialize crossbar and GPIO
+   Node_Init ();                       // Forget all remote sensors
+   Filter_MA_Init (&AVG_Filter);
+   OSCILLATOR_Init ();                 // Switch to the crystal
 
    UART1_Init ();                      // Initialize UART1
+   PCA0_Init ();                       // DHT11 edge capture
+   Tick_Init ();                       // Start the 1 ms system tick
 
    EA = 1;
 
@@ -143,164 +213,204 @@ void main (void)
 
    RELAY = 1; // 1 for the relay means OFF
 
-   i = 0;
+   Sched_Init (Tasks, TASK_COUNT);
+
+   // Run at half speed; the frame and sensor tasks raise it while they work
+   Clock_Set (CLOCK_HALF);
 
+   // The first DHT11 read is only started from here, by Sensor_Task, and
+   // does not hold up the first frame
+   Tick_Ready ();
+
+   // Idle whenever no task is ready; the next UART byte, tick or PCA
+   // capture wakes the CPU to look again
    while (1)
    {
-   		// Determine the internal temp of the coolant resevior
-	 	if (j == 0)
+      if (!Sched_Run ())
+      {
+         Tick_Idle ();
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Frame_Task
+//-----------------------------------------------------------------------------
+//
+// Handles every complete frame that has queued up in the receive ring, files
+// each reading under the node that sent it and replies to the thermostat.
+//
+// The UART signals this task for every byte, and most runs only take the
+// byte into the parser. That is done at half speed; the clock goes up once
+// a whole frame is in, and stays up until the ring has been worked through.
+//
+//-----------------------------------------------------------------------------
+
+void Frame_Task (void)
+{
+	unsigned char payloadSize;
+	unsigned int addr16;
+	unsigned char held = 0;
+
+	while (XBee_Receive())
+	{
+		if (!held)
 		{
-			GetInternalReadings();
-			//internal_temp = 32;
+			Clock_Hold ();
+			held = 1;
 		}
 
-		Set_LEDs();
-		
-		// Check for a ZigBee Rx Packet API frame that contains a combo set/actual temp pair, 
-		// and if it is, read the first two bytes
-		if ( UART_Buffer_Size == 18 && UART_Buffer[0] == 0x7E && UART_Buffer[3] == 0x90)
-		{
-			// Get the previous value
-			PREV_SET_Temp = SET_Temp;
+		if (XBee_Frame[0] != XBEE_API_RX_PACKET) continue;
 
-			// Get the previous avg
-			PREV_AVG_Temp = AVG_Temp;
+		payloadSize = XBee_Frame_Length - XBEE_RX_DATA;
 
-			// Assign the set value to a variable
-			SET_Temp = UART_Buffer[15];
+		// A ZigBee Rx Packet API frame that contains a combo set/actual temp
+		// pair comes from the thermostat. One that contains just an actual
+		// temp reading comes from a remote sensor.
+		if (payloadSize == 2)
+		{
+			SET_Temp = XBee_Frame[XBEE_RX_DATA];
+		}
+		else if (payloadSize != 1)
+		{
+			continue;
+		}
 
-			// Display the new set value if different
-			if (PREV_SET_Temp != SET_Temp)
-			{
-				Display_Temp(SET_Temp, 0);
-			}
-			
-			// Get a running avg	
-			if (first == 1) 
-			{
-				AVG_Temps[0] = AVG_Temps[1] = AVG_Temps[2] = AVG_Temps[3] = AVG_Temps[4] = AVG_Temps[5] = AVG_Temps[6] = UART_Buffer[16];
-				first = 0;
-			}
-			else 
-			{
-				AVG_Temps[i] = UART_Buffer[16];
-				i++;
-			}
+		// Average the latest reading of each node, so a node that reports
+		// more often than the others does not outweigh them
+		addr16 = ((unsigned int)XBee_Frame[XBEE_RX_ADDR16] << 8) | XBee_Frame[XBEE_RX_ADDR16 + 1];
+		Node_Update(addr16, &XBee_Frame[XBEE_RX_ADDR64], XBee_Frame[XBEE_RX_DATA + payloadSize - 1]);
 
-			AVG_Temp = (AVG_Temps[0] + AVG_Temps[1] + AVG_Temps[2] + AVG_Temps[3] + AVG_Temps[4] + AVG_Temps[5] + AVG_Temps[6]) / 7;
+		AVG_Temp = Filter_MA_Add(&AVG_Filter, Node_Average());
 
-			// Display the new avg temp from last 7 readings
-			if (PREV_AVG_Temp != AVG_Temp)
-			{
-				Display_Temp(AVG_Temp, 1);
-			}
+		Sched_Signal (TASK_DISPLAY);
 
-			if (TX_Ready == 1)
-			{	
-				TransmitData(AVG_Temp, state);
-			}
+		TransmitData(AVG_Temp, State);
+	}
 
-			UART_Buffer_Size = 0; // reset buffer
-		}
-		// Otherwise, check for a ZigBee Rx Packet API frame that contains just an actual temp reading
-		// without a set value. This will have come from a remote sensor and not the thermostat
-		else if ( UART_Buffer_Size == 17 && UART_Buffer[0] == 0x7E && UART_Buffer[3] == 0x90)
-		{
-			// Get a running avg	
-			if (first == 1) 
-			{
-				AVG_Temps[0] = AVG_Temps[1] = AVG_Temps[2] = AVG_Temps[3] = AVG_Temps[4] = AVG_Temps[5] = AVG_Temps[6] = UART_Buffer[15];
-				first = 0;
-			}
-			else 
-			{
-				AVG_Temps[i] = UART_Buffer[15];
-				i++;
-			}
+	if (held)
+	{
+		Clock_Release ();
+	}
+}
 
-			AVG_Temp = (AVG_Temps[0] + AVG_Temps[1] + AVG_Temps[2] + AVG_Temps[3] + AVG_Temps[4] + AVG_Temps[5] + AVG_Temps[6]) / 7;
+//-----------------------------------------------------------------------------
+// Sensor_Task
+//-----------------------------------------------------------------------------
+//
+// Determines the internal temp of the coolant resevior. Runs periodically to
+// start a DHT11 read, and again when PCA0_ISR signals that the read is over.
+//
+//-----------------------------------------------------------------------------
 
-			// Display the new avg temp from last 7 readings
-			Display_Temp(AVG_Temp, 1);
+void Sensor_Task (void)
+{
+	if (DHT11_State == DHT11_IDLE)
+	{
+		Clock_Hold();                   // the PCA times the read in counts
+		DHT11_Start();                  // of the full-speed SYSCLK/12
+	}
+	else if (DHT11_State == DHT11_DONE || DHT11_State == DHT11_TIMEOUT)
+	{
+		GetInternalReadings();
+		Clock_Release();
+	}
+}
 
-			if(TX_Ready == 1)
-			{	
-				TransmitData(AVG_Temp, state);
-			}
+//-----------------------------------------------------------------------------
+// Control_Task
+//-----------------------------------------------------------------------------
+//
+// Decides whether to turn the unit on or off.
+//
+//-----------------------------------------------------------------------------
 
-			UART_Buffer_Size = 0; // reset buffer
+void Control_Task (void)
+{
+	if (IsOn == 1)
+	{
+		if ( SET_Temp > AVG_Temp || internal_temp >= TENTHS(70) ) 
+		{
+			// turn unit off
+			RELAY = 1;
+			IsOn = 0;
 		}
-		else 
+	}
+	else if (IsOn == 0)
+	{
+		if ( SET_Temp < AVG_Temp && internal_temp < TENTHS(70))
 		{
-			UART_Buffer_Size = 0;
+			// turn unit on
+			RELAY = 0;
+			IsOn = 1;
 		}
+	}
 
-		if (i >= 7) i = 0;
-
-		// Do we turn the unit on or off?
-		if (j % 5 == 0)
-		{		
-			if (isOn == 1)
-			{
-				if ( SET_Temp > AVG_Temp || internal_temp >= 70.0 ) 
-				{
-					// turn unit off
-					RELAY = 1;
-					isOn = 0;
-				}
-			}
-			else if (isOn == 0)
-			{
-				if ( SET_Temp < AVG_Temp && internal_temp < 70.0)
-				{
-					// turn unit on
-					RELAY = 0;
-					isOn = 1;
-				}
-			}
-
-			if (isOn == 1) state |= 0x01; else state &= ~0x01;
-			if (internal_temp >= 70.0) state |= 0x02; else state &= ~0x02;
-		}
+	if (IsOn == 1) State |= 0x01; else State &= ~0x01;
+	if (internal_temp >= TENTHS(70)) State |= 0x02; else State &= ~0x02;
+}
 
-		j++;
+//-----------------------------------------------------------------------------
+// Display_Task
+//-----------------------------------------------------------------------------
+//
+// Shows the set value and the running average on the 7-segment displays,
+// writing only the ones that changed.
+//
+//-----------------------------------------------------------------------------
 
-		if (j >= 10) j = 0;
+void Display_Task (void)
+{
+	if (Shown_SET_Temp != SET_Temp)
+	{
+		Display_Temp(SET_Temp, 0);
+		Shown_SET_Temp = SET_Temp;
+	}
 
-		Wait_MS(1000);
-   }
+	if (Shown_AVG_Temp != AVG_Temp)
+	{
+		Display_Temp(AVG_Temp, 1);
+		Shown_AVG_Temp = AVG_Temp;
+	}
 }
 
 //-----------------------------------------------------------------------------
-// Initialization Subroutines
+// LED_Task
 //-----------------------------------------------------------------------------
 
+void LED_Task (void)
+{
+	Set_LEDs();
+}
+
 //-----------------------------------------------------------------------------
-// OSCILLATOR_Init
+// Node_Task
 //-----------------------------------------------------------------------------
 //
-// Return Value : None
-// Parameters   : None
-//
-// This function initializes the system clock to use the  external 22.1184MHz
-// crystal.
+// Drops sensors that have stopped reporting out of the average.
 //
 //-----------------------------------------------------------------------------
-void OSCILLATOR_Init (void)
-{
-   int i;                              // Software timer
-
-   OSCICN |= 0x80;                     // Enable the missing clock detector
 
-   // Initialize external crystal oscillator to use 22.1184 MHz crystal
+void Node_Task (void)
+{
+	if (Node_Age())
+	{
+		if (Node_Live == 0)
+		{
+			// Keep showing the last average; the next node restarts the filter
+			Filter_MA_Init(&AVG_Filter);
+			return;
+		}
 
-   OSCXCN = 0x67;                      // Enable external crystal osc.
-   for (i=0; i < 256; i++);            // Wait at least 1ms
-   while (!(OSCXCN & 0x80));           // Wait for crystal osc to settle
-   OSCICN |= 0x08;                     // Select external clock source
-   OSCICN &= ~0x04;                    // Disable the internal osc.
+		AVG_Temp = Filter_MA_Add(&AVG_Filter, Node_Average());
+		Sched_Signal (TASK_DISPLAY);
+	}
 }
 
+//-----------------------------------------------------------------------------
+// Initialization Subroutines
+//-----------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------
 // PORT_Init
 //-----------------------------------------------------------------------------
@@ -312,6 +422,7 @@ void OSCILLATOR_Init (void)
 //
 // P0.2   digital   push-pull     UART TX
 // P0.3   digital   open-drain    UART RX
+// P0.4   digital   open-drain    DHT11 data (PCA0 CEX0)
 //
 // P2.x	  digital   push-pull     7-seg displays and CD4543b latches
 //
@@ -334,7 +445,7 @@ void PORT_Init (void)
 	// card and this implementation would likely not be necessary on a
 	// typical 8051.
 
-   XBR0     = 0x04;		// Enable UART0			
+   XBR0     = 0x0C;		// Enable UART0 and PCA0 CEX0
 
    XBR1     = 0x00;
    XBR2     = 0x44;     // Enable crossbar and weak pull-up, enable UART1
@@ -344,6 +455,8 @@ void PORT_Init (void)
    P74OUT = 0x08;	// Sets port 5 pins 4-7 as push-pull
    P5 |= 0x0F;		
 
+   P2 = 0xAA;          // Close the latches first, so the displays keep the
+                       // blank (BCD 15) they took from the reset state
    P2MDOUT = 0xFF;     // Set all pins on port 2 to push-pull
    						// Even port 2 pins are latch enable/disable
 						// Odd port 2 pins are for 7-seg digits
@@ -352,165 +465,88 @@ void PORT_Init (void)
 }
 
 //-----------------------------------------------------------------------------
-// UART1_Init
+// PCA0_Init
 //-----------------------------------------------------------------------------
 //
 // Return Value : None
 // Parameters   : None
 //
-// Configure the UART1 using Timer1, for <baudrate> and 8-N-1.
-// This routine configures the UART1 based on the following equation:
-//
-// Baud = (2^SMOD1/32)*(SYSTEMCLOCK*12^(T1M-1))/(256-TH1)
+// Starts the PCA0 counter on SYSCLK/12 for the DHT11 decoder. Module 0
+// drives and timestamps the DHT11 line on CEX0; module 1 is used as a
+// one-shot timer for the start pulse and the read timeout.
 //
-// This equation can be found in the datasheet, Mode1 baud rate using timer1.
-// The function select the proper values of the SMOD1 and T1M bits to allow
-// for the proper baud rate to be reached.
 //-----------------------------------------------------------------------------
-void UART1_Init (void)
+void PCA0_Init (void)
 {
-   SCON1   = 0x50;                     // SCON1: mode 1, 8-bit UART, enable RX
-
-   TMOD   &= ~0xF0;
-   TMOD   |=  0x20;                    // TMOD: timer 1, mode 2, 8-bit reload
-
-
-   PCON |= 0x10;                    // SMOD1 (PCON.4) = 1 --> UART1 baudrate
-                                       // divide-by-two disabled
-   CKCON |= 0x10;                   // Timer1 uses the SYSTEMCLOCK
-   TH1 = - ((SYSTEMCLOCK/BAUDRATE)/16);
-
-   TL1 = TH1;                          // init Timer1
-   TR1 = 1;                            // START Timer1
-   TX_Ready = 1;                       // Flag showing that UART can transmit
-   EIE2     = 0x40;                    // Enable UART1 interrupts
-
-   EIP2    = 0x40;                     // Make UART high priority
+   PCA0MD = 0x00;                      // SYSCLK/12, no overflow interrupt
+   PCA0CPM0 = 0x00;                    // Both modules off, CEX0 released
+   PCA0CPM1 = 0x00;
+   PCA0CN = 0x00;                      // Clear all flags
+   CR = 1;                             // Start the PCA counter
+   EIE1 |= 0x08;                       // Enable PCA0 interrupts
 }
 
 //-----------------------------------------------------------------------------
-// Interrupt Service Routines
+// Support Subroutines
 //-----------------------------------------------------------------------------
 
 //-----------------------------------------------------------------------------
-// UART1_Interrupt
+// TransmitData
 //-----------------------------------------------------------------------------
 //
-// This routine is invoked whenever a byte is received from UART or transmitted.
+// Return Value : 1 if the frame was queued, 0 if both Tx slots are busy
+// Parameters   :
+//   1) short avgTemp - average room temp, payload byte 0
+//   2) char state - system state, payload byte 1
+//
+// Transmits a ZigBee Transmit Request frame with the avg temp in byte 0 and
+// the system state in byte 1 (bit 1 is on/off and bit 2 is coolant remaining
+// or empty.
+//
+// The thermostat's 16-bit address is fixed at 0x8949.
 //
 //-----------------------------------------------------------------------------
 
-void UART1_Interrupt (void) interrupt 20
+unsigned char TransmitData(short avgTemp, char state)
 {
-   if ((SCON1 & 0x01) == 0x01)
-   {
-      // Check if a new word is being entered
-      if( UART_Buffer_Size == 0)  
-	  {
-         UART_Input_First = 0; 
-	  } 
-
-      SCON1 = (SCON1 & 0xFE);          //RI1 = 0;
-      Byte = SBUF1;                    // Read a character from Hyperterminal
-		
-      if (UART_Buffer_Size < UART_BUFFERSIZE)
-      {
-         UART_Buffer[UART_Input_First] = Byte;  // Store character
-
-         UART_Buffer_Size++;            // Update array's size
-
-         UART_Input_First++;            // Update counter
-      }
-   }
-
-   if ((SCON1 & 0x02) == 0x02)         // Check if transmit flag is set
-   {
-      SCON1 = (SCON1 & 0xFD);
-      if (UART_Buffer_Size != 1)        // If buffer not empty
-      {
+	unsigned char payload[2];
 
-         // Check if a new word is being output
-         if ( UART_Buffer_Size == UART_Input_First )  
-         {
-            UART_Output_First = 0;
-         }
+	payload[0] = avgTemp; // temp
+	payload[1] = state; // state
 
-         Byte = UART_Buffer[UART_Output_First];
-
-         SBUF1 = Byte;
-
-         UART_Output_First++;           // Update counter
-         UART_Buffer_Size--;            // Decrease array size
-      }
-      else
-      {
-         UART_Buffer_Size = 0;           // Set the array size to 0
-         TX_Ready = 1;                   // Indicate transmission complete
-      }
-   }
+	return XBee_Transmit(0x8949, payload, 2);
 }
 
 //-----------------------------------------------------------------------------
-// Support Subroutines
-//-----------------------------------------------------------------------------
-
-//-----------------------------------------------------------------------------
-// TransmitData
+// DHT11_Start
 //-----------------------------------------------------------------------------
 //
-// Transmits a ZigBee Transmit Request frame with the avg temp in byte 0 and
-// the system state in byte 1 (bit 1 is on/off and bit 2 is coolant remaining
-// or empty.
+// Return Value : None
+// Parameters   : None
+//
+// Starts a non-blocking DHT11 read. CEX0 is held low for the 18 ms start
+// signal by putting module 0 in PWM mode with its comparator off, and module
+// 1 is armed to interrupt when the 18 ms are up. PCA0_ISR does the rest.
 //
 //-----------------------------------------------------------------------------
 
-void TransmitData(short avgTemp, char state)
+void DHT11_Start (void)
 {
-	short i = 0;
-	int sum = 0;
-
-	UART_Buffer[0] = 0x7E; // start byte
-	UART_Buffer[1] = 0x00; // Length MSB
-	UART_Buffer[2] = 0x10; // Length LSB
-	UART_Buffer[3] = 0x10; // frame type (0x10 = transmit request)
-	UART_Buffer[4] = 0x01; // frame ID
-
-	UART_Buffer[5] = 0xFF;	// start 64-bit addr
-	UART_Buffer[6] = 0xFF;
-	UART_Buffer[7] = 0xFF;
-	UART_Buffer[8] = 0xFF;
-	UART_Buffer[9] = 0xFF;
-	UART_Buffer[10] = 0xFF;
-	UART_Buffer[11] = 0xFF;
-	UART_Buffer[12] = 0xFF;
-
-	UART_Buffer[13] = 0x89;	// start 16-bit addr, we know 0x8949 is addr of the thermostat
-	UART_Buffer[14] = 0x49;
-
-	UART_Buffer[15] = 0x00;
-	UART_Buffer[16] = 0x01; //disable ack
-
-	UART_Buffer[17] = avgTemp; // temp
-	UART_Buffer[18] = state; // state
-
-	// compute the checksum per the ZigBee API spec
-	// Algorithm: Add all bytes except the first three, then remove
-	// all but the first 8 bits and subtract that value from 0xFF
-	for ( i = 3; i <= 18; i++ )
-	{
-		sum = sum + (int)UART_Buffer[i];
-	}
+	unsigned int due;
 
-	sum = sum & ~0xFF00;
+	dht11_dat[0] = dht11_dat[1] = dht11_dat[2] = dht11_dat[3] = dht11_dat[4] = 0;
+	DHT11_Edges = 0;
+	DHT11_State = DHT11_START;
 
-	sum = 0xFF - sum;
+	PCA0CPM0 = 0x02;                     // 8-bit PWM, ECOM0 = 0: CEX0 low
 
-	UART_Buffer[19] = sum;// checksum
-	UART_Buffer_Size = 19;
-	// example API frame: 7E 00 10 10 01 FF FF FF FF FF FF FF FF FF FE 00 00 58 03 9E
+	due = PCA0L;                         // reading PCA0L latches PCA0H
+	due |= (unsigned int)PCA0H << 8;
+	due += DHT11_START_COUNTS;
 
-	TX_Ready = 0;
-	SCON1 = (SCON1 | 0x02);
+	PCA0CPM1 = 0x49;                     // software timer, interrupt on match
+	PCA0CPL1 = due;
+	PCA0CPH1 = due >> 8;
 }
 
 //-----------------------------------------------------------------------------
@@ -519,152 +555,110 @@ void TransmitData(short avgTemp, char state)
 //
 // Determines the temp inside the cooler. This is used to determine how much
 // coolant is remaining. The value is not intended for direct display to the
-// user in decimal format. The value is read off a DHT11 using a form of
-// software serial.
+// user in decimal format.
+//
+// Called once PCA0_ISR has finished a DHT11 read. Checks the result and
+// counts checksum failures and timeouts, then leaves the decoder idle for
+// the next read.
 //
 //-----------------------------------------------------------------------------
 
 void GetInternalReadings ()
 {
-	bit laststate	= 1;
-	short xstate = 1;
-    short counter		= 0;
-	short j	= 0, i;
-    float f;
-
-	dht11_dat[0] = dht11_dat[1] = dht11_dat[2] = dht11_dat[3] = dht11_dat[4] = 0;
-
-	// Note: DHT11 pin is P1.4
-
-	// set DHT11 pin to output
-	// set DHT11 pin to push-pull
-	P1MDOUT |= 0x10; // set the 16's bit
-
-	// write DHT11 pin low
-	DHT11 = 0;
+    signed int f;
 
-	// delay 18 ms
-	Wait_MS(18);
-
-	// write DHT11 pin high
-	DHT11 = 1;
-
-	// delay 40 us
-	Wait_uS(40);
-
-	// set DHT pin to input
-	P1MDOUT &= ~0x10;  // unset the 16's bit
-	DHT11 = 1;
-	xstate = DHT11;
-
-	//reads %RH and Temp. (F & C)
-    for (i=0; i< 85; i++) 
+	if (DHT11_State == DHT11_TIMEOUT)
 	{
-        counter = 0;
-        while (DHT11 == laststate) 
-		{
-            counter++;
-            Wait_uS(1);
-            if (counter == 255) 
-			{
-                break;
-            }
-        }
-        laststate = DHT11;
-
-		if (laststate == 0) 
-		{
-			xstate = xstate + 1;
-		}
-
-        if (counter == 255) break;
-
-        // ignore first 3 transitions
-        if ((i >= 4) && (i%2 == 0)) {
-            // shove each bit into the storage bytes
-            dht11_dat[j/8] <<= 1;
-            if (counter > 16)
-                dht11_dat[j/8] |= 1;
-            j++;
-        }
-    }
-
-    if ((j >= 40) &&
-                (dht11_dat[4] == ((dht11_dat[0] + dht11_dat[1] + dht11_dat[2] + dht11_dat[3]) & 0xFF)) ) 
+		DHT11_Timeouts++;
+	}
+	else if (dht11_dat[4] == ((dht11_dat[0] + dht11_dat[1] + dht11_dat[2] + dht11_dat[3]) & 0xFF)) 
 	{
-        f = dht11_dat[2] * 9.0 / 5.0 + 32.0;
-		if (f > 0.0f)
+		// C to F in tenths: C * 9/5 * 10 + 320
+        f = dht11_dat[2] * 18 + TENTHS(32);
+		if (f > 0)
         	internal_temp = f;
-    }
+	}
+	else
+	{
+		DHT11_Checksum_Errors++;
+	}
 
+	DHT11_State = DHT11_IDLE;
 }
 
 //-----------------------------------------------------------------------------
-// Wait_MS
+// PCA0_ISR
 //-----------------------------------------------------------------------------
 //
-// Return Value : None
-// Parameters:
-//   1) unsigned int ms - number of milliseconds of delay
-//                        range is full range of integer: 0 to 65335
+// Module 1 match: the 18 ms start signal is over, so release CEX0 and start
+// capturing falling edges on it, with a 10 ms timeout. A second match means
+// the sensor never finished and the read is abandoned.
 //
-// This routine inserts a delay of <ms> milliseconds.
+// Module 0 capture: one falling edge on the DHT11 line. Every bit is a 50 us
+// low followed by a 26-28 us (0) or 70 us (1) high, so the time between two
+// falling edges is about 77 us for a 0 and 120 us for a 1. The first edge
+// starts the sensor's response and the second ends it, so the 40 data bits
+// are the periods ending at edges 2 to 41.
 //
 //-----------------------------------------------------------------------------
-void Wait_MS(unsigned int ms)
-{
-
-   CKCON &= ~0x20;                     // use SYSCLK/12 as timebase
-
-   RCAP2 = -(SYSTEMCLOCK/1000/12);          // Timer 2 overflows at 1 kHz
-   TMR2 = RCAP2;
 
-   ET2 = 0;                            // Disable Timer 2 interrupts
+INTERRUPT (PCA0_ISR, INTERRUPT_PCA0)
+{
+	unsigned int now;
+	unsigned char bitIndex;
 
-   TR2 = 1;                            // Start Timer 2
+	if (CCF1)
+	{
+		CCF1 = 0;
 
-   while(ms)
-   {
-      TF2 = 0;                         // Clear flag to initialize
-      while(!TF2);                     // Wait until timer overflows
-      ms--;                            // Decrement ms
-   }
+		if (DHT11_State == DHT11_START)
+		{
+			PCA0CPM0 = 0x11;             // capture falling edges, interrupt
 
-   TR2 = 0;                            // Stop Timer 2
-}
+			now = PCA0CPL1 | ((unsigned int)PCA0CPH1 << 8);
+			now += DHT11_TIMEOUT_COUNTS;
+			PCA0CPL1 = now;
+			PCA0CPH1 = now >> 8;
 
-//-----------------------------------------------------------------------------
-// Wait_uS
-//-----------------------------------------------------------------------------
-//
-// Return Value : None
-// Parameters:
-//   1) unsigned int us - number of microseconds of delay
-//                        range is full range of integer: 0 to 65335
-//
-// This routine inserts a delay of <us> microseconds.
-//
-//-----------------------------------------------------------------------------
-void Wait_uS(unsigned int us)
-{
+			DHT11_State = DHT11_RECEIVE;
+		}
+		else
+		{
+			PCA0CPM0 = 0x00;
+			PCA0CPM1 = 0x00;
+			DHT11_State = DHT11_TIMEOUT;
+			Sched_Signal (TASK_SENSOR);
+		}
+	}
 
-   CKCON &= ~0x20;                     // use SYSCLK/12 as timebase
+	if (CCF0)
+	{
+		CCF0 = 0;
 
-   RCAP2 = -(SYSTEMCLOCK/ 1000000 /12);          // Timer 2 overflows at 1 kHz
-   TMR2 = RCAP2;
+		now = PCA0CPL0 | ((unsigned int)PCA0CPH0 << 8);
 
-   ET2 = 0;                            // Disable Timer 2 interrupts
+		if (DHT11_Edges >= 2)
+		{
+			bitIndex = DHT11_Edges - 2;
+			dht11_dat[bitIndex >> 3] <<= 1;
 
-   TR2 = 1;                            // Start Timer 2
+			if ((unsigned short)(now - DHT11_Last) > DHT11_ONE_COUNTS)
+			{
+				dht11_dat[bitIndex >> 3] |= 1;
+			}
+		}
 
-   while(us)
-   {
-      TF2 = 0;                         // Clear flag to initialize
-      while(!TF2);                     // Wait until timer overflows
-      us--;                            // Decrement ms
-   }
+		DHT11_Last = now;
+		DHT11_Edges++;
 
-   TR2 = 0;                            // Stop Timer 2
+		if (DHT11_Edges == DHT11_EDGES)
+		{
+			PCA0CPM0 = 0x00;
+			PCA0CPM1 = 0x00;
+			DHT11_State = DHT11_DONE;
+			Sched_Signal (TASK_SENSOR);
+		}
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -678,21 +672,21 @@ void Wait_uS(unsigned int us)
 
 void Set_LEDs()
 {
-	if (internal_temp == 0.0) return;
+	if (internal_temp == 0) return;
 
-	if (internal_temp >= 70.0) 
+	if (internal_temp >= TENTHS(70)) 
 	{
 		P5 = 0; // gone
 	}
-	else if (internal_temp < 70.0 && internal_temp >= 60.0)
+	else if (internal_temp >= TENTHS(60))
 	{
 		P5 |= 0x10; // almost out
 	}
-	else if (internal_temp < 60.0 && internal_temp >= 50.0)
+	else if (internal_temp >= TENTHS(50))
 	{
 		P5 |= 0x30; // 50 to 60 it's getting low
 	}
-	else if (internal_temp < 50.0 && internal_temp >= 40)
+	else if (internal_temp >= TENTHS(40))
 	{
 		P5 |= 0x70; // 40 to 50, we assume we're 3/4 full
 	}
@@ -714,152 +708,94 @@ void Set_LEDs()
 //
 //-----------------------------------------------------------------------------
 
-void Display_Temp(float measurement, short output)
+void Display_Temp(short measurement, short output)
 {
-	short firstDigit = 0;
-	short tens = 0;
-	short secondDigit = 0;
-
-	if (measurement < 0.0) measurement = 0.0f;
-	if (measurement >= 100.0) measurement = 99.0f;
+	unsigned char value;
 
-	firstDigit = (short)(measurement / 10.0f);
-	
-	if (firstDigit > 0.0f) 
-	{
-		Display_Digit(firstDigit, 0 + (output * 2));
-	}
-	else 
-	{
-		Display_Digit(0, 0 + (output * 2));
-	}
+	if (measurement < 0) measurement = 0;
+	if (measurement >= 100) measurement = 99;
 
-	tens = (short)firstDigit * 10;
+	// 8-bit divide and modulo both come from a single DIV AB
+	value = (unsigned char)measurement;
 
-	secondDigit = (short)measurement - tens;
-
-	Display_Digit(secondDigit, 1 + (output * 2));
+	Display_Digit(value / 10, 0 + (output * 2));
+	Display_Digit(value % 10, 1 + (output * 2));
 }
 
 //-----------------------------------------------------------------------------
 // Displays a digit on the given latch line
 //-----------------------------------------------------------------------------
 //
-// Displays a single digit on the given latch line, 0-3. The latch that needs 
-// to be open (so it can be changed) is sent a high signal. The rest are set
-// to low so that the digit does not get written to them, and they hold onto
-// the last value that was sent.
+// Displays a single digit, 0-9, on the given latch line, 0-3. A CD4543B
+// follows its BCD inputs while its latch enable is high and holds the last
+// value once it goes low. So the BCD lines are set first with every latch
+// closed, then the one latch is opened and closed again on a value that is
+// already steady, and no display ever shows a passing wrong digit. The
+// other displays hold onto the last value that was sent to them.
 //
 //-----------------------------------------------------------------------------
 
-void Display_Digit(short digit, short latch) 
+#ifdef DISPLAY_PORT
+
+// BCD inputs for each digit
+static unsigned char SEG_CODE Display_Bcd[10] =
+{
+	0,
+	DISPLAY_BCD1,
+	DISPLAY_BCD2,
+	DISPLAY_BCD2 | DISPLAY_BCD1,
+	DISPLAY_BCD4,
+	DISPLAY_BCD4 | DISPLAY_BCD1,
+	DISPLAY_BCD4 | DISPLAY_BCD2,
+	DISPLAY_BCD4 | DISPLAY_BCD2 | DISPLAY_BCD1,
+	DISPLAY_BCD8,
+	DISPLAY_BCD8 | DISPLAY_BCD1
+};
+
+static unsigned char SEG_CODE Display_Latch[4] =
+{
+	DISPLAY_LATCH0, DISPLAY_LATCH1, DISPLAY_LATCH2, DISPLAY_LATCH3
+};
+
+void Display_Digit(unsigned char digit, unsigned char latch)
+{
+	unsigned char bus = (DISPLAY_PORT & ~DISPLAY_MASK) | Display_Bcd[digit];
+
+	DISPLAY_PORT = bus;                           // latches closed, new BCD
+	DISPLAY_PORT = bus | Display_Latch[latch & 3];   // one latch takes it
+	DISPLAY_PORT = bus;                           // and holds it
+}
+
+#else
+
+void Display_Digit(unsigned char digit, unsigned char latch)
 {
 	// latch 0 == leftmost 7-seg display
 	// latch 1 == second to leftmost 7-seg display
 	// latch 2 == second to rightmost 7-seg display
 	// latch 3 == rightmost 7-seg display
 
-	if (latch == 0) 
-	{
-		LATCH0 = 1;
-		LATCH1 = 0;
-		LATCH2 = 0;
-		LATCH4 = 0;		
-	}	
-	else if (latch == 1) 
-	{
-		LATCH0 = 0;
-		LATCH1 = 1;
-		LATCH2 = 0;
-		LATCH4 = 0;
-	}	
-	else if (latch == 2) 
-	{
-		LATCH0 = 0;
-		LATCH1 = 0;
-		LATCH2 = 1;
-		LATCH4 = 0;
-	}	
-	else if (latch == 3) 
-	{
-		LATCH0 = 0;
-		LATCH1 = 0;
-		LATCH2 = 0;
-		LATCH4 = 1;
-	}
+	LATCH0 = 0;
+	LATCH1 = 0;
+	LATCH2 = 0;
+	LATCH4 = 0;
 
-	if (digit == 0) 
-	{
-			DIGIT1 = 0;
-			DIGIT2 = 0;
-			DIGIT4 = 0;
-			DIGIT8 = 0;
-	}
-	else if (digit ==  1)
-	{
-			DIGIT1 = 1;
-			DIGIT2 = 0;
-			DIGIT4 = 0;
-			DIGIT8 = 0;
-	}
-	else if (digit ==  2)
-	{
-			DIGIT1 = 0;
-			DIGIT2 = 1;
-			DIGIT4 = 0;
-			DIGIT8 = 0;
-	}
-	else if (digit ==  3)
-	{
-			DIGIT1 = 1;
-			DIGIT2 = 1;
-			DIGIT4 = 0;
-			DIGIT8 = 0;
-	}
-	else if (digit ==  4)
-	{
-			DIGIT1 = 0;
-			DIGIT2 = 0;
-			DIGIT4 = 1;
-			DIGIT8 = 0;
-	}
-	else if (digit ==  5)
-	{
-			DIGIT1 = 1;
-			DIGIT2 = 0;
-			DIGIT4 = 1;
-			DIGIT8 = 0;
-	}
-	else if (digit ==  6)
-	{
-			DIGIT1 = 0;
-			DIGIT2 = 1;
-			DIGIT4 = 1;
-			DIGIT8 = 0;
-	}
-	else if (digit ==  7)
-	{
-			DIGIT1 = 1;
-			DIGIT2 = 1;
-			DIGIT4 = 1;
-			DIGIT8 = 0;
-	}
-	else if (digit ==  8)
-	{
-			DIGIT1 = 0;
-			DIGIT2 = 0;
-			DIGIT4 = 0;
-			DIGIT8 = 1;
-	}
-	else if (digit ==  9)
+	DIGIT1 = digit & 1;
+	DIGIT2 = (digit >> 1) & 1;
+	DIGIT4 = (digit >> 2) & 1;
+	DIGIT8 = (digit >> 3) & 1;
+
+	switch (latch & 3)
 	{
-			DIGIT1 = 1;
-			DIGIT2 = 0;
-			DIGIT4 = 0;
-			DIGIT8 = 1;
+		case 0: LATCH0 = 1; LATCH0 = 0; break;
+		case 1: LATCH1 = 1; LATCH1 = 0; break;
+		case 2: LATCH2 = 1; LATCH2 = 0; break;
+		case 3: LATCH4 = 1; LATCH4 = 0; break;
 	}
 }
 
+#endif                                 // DISPLAY_PORT
+
 //-----------------------------------------------------------------------------
 // End Of File
 //-----------------------------------------------------------------------------
\ No newline at end of file
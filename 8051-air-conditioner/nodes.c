@@ -0,0 +1,331 @@
+//-----------------------------------------------------------------------------
+// nodes.c
+//-----------------------------------------------------------------------------
+//
+// Per-source sensor table. See nodes.h for the overview.
+//
+// A node that times out keeps its slot, marked dead, so that it lands in the
+// same place when it comes back, and a new node may take over any dead slot
+// on its probe path. Dead slots off the path stay in use until NODE_MAX slots
+// have been taken; the next new node then has Node_Compact empty them all
+// and move the live nodes back towards their home slots. The sum and count
+// of the live readings are kept up to date on every change so the average
+// never needs a pass over the table.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include <C8051F020_defs.h>            // SFR declarations
+#include "timer.h"
+#include "nodes.h"
+
+//-----------------------------------------------------------------------------
+// Global Constants
+//-----------------------------------------------------------------------------
+
+#define NODE_USED    0x01              // slot has held a node
+#define NODE_ALIVE   0x02              // node is counted in the average
+#define NODE_KEY64   0x04              // key is folded from the 64-bit address
+
+#define NODE_MASK    (NODE_SLOTS - 1)
+
+// First slot on the probe path of a key
+#define NODE_HOME(key)  ((((key) >> 8) ^ (key)) & NODE_MASK)
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+typedef struct
+{
+   unsigned int key;                   // source address, see Node_Update
+   unsigned char flags;
+   unsigned char reading;              // latest temp from this node
+   unsigned int seen;                  // tick of the latest reading
+   unsigned char samples;              // readings received, saturates at 255
+} Node_Entry;
+
+static Node_Entry SEG_XDATA Nodes[NODE_SLOTS];
+
+static unsigned char Node_Used = 0;    // slots holding a node, live or dead
+static unsigned int Node_Sum = 0;      // sum of the live readings
+
+unsigned char Node_Live = 0;
+unsigned char Node_Full = 0;
+
+//-----------------------------------------------------------------------------
+// Node_Init
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Empties the table. XRAM is not cleared at reset by the startup code.
+//
+//-----------------------------------------------------------------------------
+void Node_Init (void)
+{
+   unsigned char i;
+
+   for (i = 0; i < NODE_SLOTS; i++)
+   {
+      Nodes[i].flags = 0;
+   }
+
+   Node_Used = 0;
+   Node_Live = 0;
+   Node_Sum = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Node_Compact
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Empties every dead slot, then moves each live node to the first empty slot
+// on its probe path. The pass starts just after a never-used slot and goes
+// once round the table, so every slot between a node's home and the node
+// has already been settled when the node is looked at. Leaves Node_Used
+// equal to Node_Live.
+//
+//-----------------------------------------------------------------------------
+static void Node_Compact (void)
+{
+   Node_Entry SEG_XDATA *entry;
+   Node_Entry SEG_XDATA *to;
+   unsigned char slot;
+   unsigned char home;
+   unsigned char i;
+
+   slot = 0;
+
+   while (Nodes[slot].flags & NODE_USED)
+   {
+      slot++;
+   }
+
+   for (i = 0; i < NODE_SLOTS; i++)
+   {
+      if (!(Nodes[i].flags & NODE_ALIVE))
+      {
+         Nodes[i].flags = 0;
+      }
+   }
+
+   for (i = 0; i < NODE_SLOTS; i++)
+   {
+      slot = (slot + 1) & NODE_MASK;
+      entry = &Nodes[slot];
+
+      if (!(entry->flags & NODE_USED))
+      {
+         continue;
+      }
+
+      home = NODE_HOME(entry->key);
+
+      while (home != slot && (Nodes[home].flags & NODE_USED))
+      {
+         home = (home + 1) & NODE_MASK;
+      }
+
+      if (home != slot)
+      {
+         to = &Nodes[home];
+         to->key = entry->key;
+         to->flags = entry->flags;
+         to->reading = entry->reading;
+         to->seen = entry->seen;
+         to->samples = entry->samples;
+         entry->flags = 0;
+      }
+   }
+
+   Node_Used = Node_Live;
+}
+
+//-----------------------------------------------------------------------------
+// Node_Update
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   :
+//   1) unsigned int addr16 - 16-bit network address of the sender
+//   2) unsigned char *addr64 - 8-byte 64-bit address of the sender
+//   3) unsigned char reading - temp the sender reported
+//
+// Records the latest reading from one node. Nodes are keyed by their 16-bit
+// network address. When the XBee reports the network address as unknown
+// (0xFFFE) the 64-bit address is folded down to 16 bits instead, and the
+// entry is flagged so it can never match a real network address.
+//
+//-----------------------------------------------------------------------------
+void Node_Update (unsigned int addr16, unsigned char *addr64,
+                  unsigned char reading)
+{
+   Node_Entry SEG_XDATA *entry;
+   unsigned char keyType = 0;
+   unsigned char slot;
+   unsigned char freeSlot = 0xFF;
+   unsigned char i;
+
+   if (addr16 == NODE_ADDR16_UNKNOWN)
+   {
+      keyType = NODE_KEY64;
+      addr16 = 0;
+
+      for (i = 0; i < 8; i += 2)
+      {
+         addr16 ^= ((unsigned int)addr64[i] << 8) | addr64[i + 1];
+      }
+   }
+
+   // Probe from the home slot until the key or a never-used slot turns up.
+   // There is always a never-used slot since at most half are ever used.
+   slot = NODE_HOME(addr16);
+
+   while (1)
+   {
+      entry = &Nodes[slot];
+
+      if (!(entry->flags & NODE_USED))
+      {
+         break;
+      }
+
+      if (entry->key == addr16 && (entry->flags & NODE_KEY64) == keyType)
+      {
+         // Known node: swap its old reading for the new one in the sum
+         if (entry->flags & NODE_ALIVE)
+         {
+            Node_Sum -= entry->reading;
+         }
+         else
+         {
+            entry->flags |= NODE_ALIVE;
+            Node_Live++;
+         }
+
+         Node_Sum += reading;
+         entry->reading = reading;
+         entry->seen = Tick_Now();
+
+         if (entry->samples != 0xFF)
+         {
+            entry->samples++;
+         }
+
+         return;
+      }
+
+      if (freeSlot == 0xFF && !(entry->flags & NODE_ALIVE))
+      {
+         freeSlot = slot;              // dead node, first one we can reuse
+      }
+
+      slot = (slot + 1) & NODE_MASK;
+   }
+
+   // New node: reuse a dead slot on the probe path if there was one. With
+   // NODE_MAX slots taken and some of them dead, clear out the dead ones and
+   // probe again for an empty slot.
+   if (freeSlot != 0xFF)
+   {
+      entry = &Nodes[freeSlot];
+   }
+   else
+   {
+      if (Node_Used == NODE_MAX)
+      {
+         if (Node_Live == NODE_MAX)
+         {
+            Node_Full++;
+            return;
+         }
+
+         Node_Compact ();
+         slot = NODE_HOME(addr16);
+
+         while (Nodes[slot].flags & NODE_USED)
+         {
+            slot = (slot + 1) & NODE_MASK;
+         }
+
+         entry = &Nodes[slot];
+      }
+
+      Node_Used++;
+   }
+
+   entry->key = addr16;
+   entry->flags = NODE_USED | NODE_ALIVE | keyType;
+   entry->reading = reading;
+   entry->seen = Tick_Now();
+   entry->samples = 1;
+
+   Node_Sum += reading;
+   Node_Live++;
+}
+
+//-----------------------------------------------------------------------------
+// Node_Age
+//-----------------------------------------------------------------------------
+//
+// Return Value : 1 if any node died, otherwise 0
+// Parameters   : None
+//
+// Takes nodes that have been silent for NODE_TIMEOUT ms out of the average.
+// Call about once a second so no entry ages past the tick wrapping around.
+//
+//-----------------------------------------------------------------------------
+unsigned char Node_Age (void)
+{
+   Node_Entry SEG_XDATA *entry;
+   unsigned char i;
+   unsigned char died = 0;
+
+   for (i = 0; i < NODE_SLOTS; i++)
+   {
+      entry = &Nodes[i];
+
+      if ((entry->flags & NODE_ALIVE) &&
+          Tick_Expired(entry->seen + NODE_TIMEOUT))
+      {
+         entry->flags &= ~NODE_ALIVE;
+         Node_Sum -= entry->reading;
+         Node_Live--;
+         died = 1;
+      }
+   }
+
+   return died;
+}
+
+//-----------------------------------------------------------------------------
+// Node_Average
+//-----------------------------------------------------------------------------
+//
+// Return Value : average of the latest reading of every live node, or 0 if
+//                no node is live
+// Parameters   : None
+//
+//-----------------------------------------------------------------------------
+unsigned char Node_Average (void)
+{
+   if (Node_Live == 0)
+   {
+      return 0;
+   }
+
+   return Node_Sum / Node_Live;
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,55 @@
+//-----------------------------------------------------------------------------
+// nodes.h
+//-----------------------------------------------------------------------------
+//
+// Table of remote temperature sensors, one entry per XBee source address.
+//
+// Every ZigBee Rx Packet that carries a temperature updates the entry for
+// the radio that sent it, so a chatty node only ever counts once in the
+// average. Entries that have not been heard from for NODE_TIMEOUT ms are
+// marked dead and drop out of the average until the node is heard again.
+//
+// The table is an open-addressed hash table in XRAM keyed by the 16-bit
+// network address, with linear probing. At most NODE_MAX of its NODE_SLOTS
+// slots are ever used, so the table is at most half full and a lookup
+// touches two or three slots on average whatever the number of nodes.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef NODES_H
+#define NODES_H
+
+//-----------------------------------------------------------------------------
+// Global Constants
+//-----------------------------------------------------------------------------
+
+#define NODE_MAX      64               // radios tracked at once
+#define NODE_SLOTS    128              // power of two, at least 2 * NODE_MAX
+#define NODE_TIMEOUT  30000            // ms of silence before a node is dead,
+                                       // below 32768 for Tick_Expired
+
+// Network address the XBee reports when it does not know the sender's
+#define NODE_ADDR16_UNKNOWN  0xFFFE
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+extern unsigned char Node_Live;        // nodes currently in the average
+extern unsigned char Node_Full;        // readings dropped, table full
+
+//-----------------------------------------------------------------------------
+// Function Prototypes
+//-----------------------------------------------------------------------------
+
+void Node_Init (void);
+void Node_Update (unsigned int addr16, unsigned char *addr64,
+                  unsigned char reading);
+unsigned char Node_Age (void);
+unsigned char Node_Average (void);
+
+#endif                                 // NODES_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
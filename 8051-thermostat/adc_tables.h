@@ -0,0 +1,97 @@
+//-----------------------------------------------------------------------------
+// adc_tables.h
+//-----------------------------------------------------------------------------
+//
+// Generated by tools/adc_tables.py; do not edit. Change the calibration and
+// run `make adc-tables` instead.
+//
+// Calibration:
+//    TMP36  code 91 at 32 F, 1.8 F per code
+//    dial   50 F at code 0 to 90 F at code 255
+//
+// Included once, by main.c.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef ADC_TABLES_H
+#define ADC_TABLES_H
+
+// Room temp in 1/16 F for each ADC1 code
+static unsigned int SEG_CODE Temp_Table[256] =
+{
+      0,    0,    0,    0,    0,    0,    0,    0,   //   0
+      0,    0,    0,    0,    0,    0,    0,    0,   //   8
+      0,    0,    0,    0,    0,    0,    0,    0,   //  16
+      0,    0,    0,    0,    0,    0,    0,    0,   //  24
+      0,    0,    0,    0,    0,    0,    0,    0,   //  32
+      0,    0,    0,    0,    0,    0,    0,    0,   //  40
+      0,    0,    0,    0,    0,    0,    0,    0,   //  48
+      0,    0,    0,    0,    0,    0,    0,    0,   //  56
+      0,    0,    0,    0,    0,    0,    0,    0,   //  64
+      0,    0,   22,   51,   80,  109,  138,  166,   //  72
+    195,  224,  253,  282,  310,  339,  368,  397,   //  80
+    426,  454,  483,  512,  541,  570,  598,  627,   //  88
+    656,  685,  714,  742,  771,  800,  829,  858,   //  96
+    886,  915,  944,  973, 1002, 1030, 1059, 1088,   // 104
+   1117, 1146, 1174, 1203, 1232, 1261, 1290, 1318,   // 112
+   1347, 1376, 1405, 1434, 1462, 1491, 1520, 1549,   // 120
+   1578, 1606, 1635, 1664, 1693, 1722, 1750, 1779,   // 128
+   1808, 1837, 1866, 1894, 1923, 1952, 1981, 2010,   // 136
+   2038, 2067, 2096, 2125, 2154, 2182, 2211, 2240,   // 144
+   2269, 2298, 2326, 2355, 2384, 2413, 2442, 2470,   // 152
+   2499, 2528, 2557, 2586, 2614, 2643, 2672, 2701,   // 160
+   2730, 2758, 2787, 2816, 2845, 2874, 2902, 2931,   // 168
+   2960, 2989, 3018, 3046, 3075, 3104, 3133, 3162,   // 176
+   3190, 3219, 3248, 3277, 3306, 3334, 3363, 3392,   // 184
+   3421, 3450, 3478, 3507, 3536, 3565, 3594, 3622,   // 192
+   3651, 3680, 3709, 3738, 3766, 3795, 3824, 3853,   // 200
+   3882, 3910, 3939, 3968, 3997, 4026, 4054, 4080,   // 208
+   4080, 4080, 4080, 4080, 4080, 4080, 4080, 4080,   // 216
+   4080, 4080, 4080, 4080, 4080, 4080, 4080, 4080,   // 224
+   4080, 4080, 4080, 4080, 4080, 4080, 4080, 4080,   // 232
+   4080, 4080, 4080, 4080, 4080, 4080, 4080, 4080,   // 240
+   4080, 4080, 4080, 4080, 4080, 4080, 4080, 4080    // 248
+};
+
+// Set point in F for each ADC1 code
+static unsigned char SEG_CODE Dial_Table[256] =
+{
+   50, 50, 50, 50, 50, 50, 50, 51,   //   0
+   51, 51, 51, 51, 51, 52, 52, 52,   //   8
+   52, 52, 52, 52, 53, 53, 53, 53,   //  16
+   53, 53, 54, 54, 54, 54, 54, 54,   //  24
+   55, 55, 55, 55, 55, 55, 55, 56,   //  32
+   56, 56, 56, 56, 56, 57, 57, 57,   //  40
+   57, 57, 57, 58, 58, 58, 58, 58,   //  48
+   58, 58, 59, 59, 59, 59, 59, 59,   //  56
+   60, 60, 60, 60, 60, 60, 60, 61,   //  64
+   61, 61, 61, 61, 61, 62, 62, 62,   //  72
+   62, 62, 62, 63, 63, 63, 63, 63,   //  80
+   63, 63, 64, 64, 64, 64, 64, 64,   //  88
+   65, 65, 65, 65, 65, 65, 66, 66,   //  96
+   66, 66, 66, 66, 66, 67, 67, 67,   // 104
+   67, 67, 67, 68, 68, 68, 68, 68,   // 112
+   68, 68, 69, 69, 69, 69, 69, 69,   // 120
+   70, 70, 70, 70, 70, 70, 71, 71,   // 128
+   71, 71, 71, 71, 71, 72, 72, 72,   // 136
+   72, 72, 72, 73, 73, 73, 73, 73,   // 144
+   73, 74, 74, 74, 74, 74, 74, 74,   // 152
+   75, 75, 75, 75, 75, 75, 76, 76,   // 160
+   76, 76, 76, 76, 76, 77, 77, 77,   // 168
+   77, 77, 77, 78, 78, 78, 78, 78,   // 176
+   78, 79, 79, 79, 79, 79, 79, 79,   // 184
+   80, 80, 80, 80, 80, 80, 81, 81,   // 192
+   81, 81, 81, 81, 82, 82, 82, 82,   // 200
+   82, 82, 82, 83, 83, 83, 83, 83,   // 208
+   83, 84, 84, 84, 84, 84, 84, 84,   // 216
+   85, 85, 85, 85, 85, 85, 86, 86,   // 224
+   86, 86, 86, 86, 87, 87, 87, 87,   // 232
+   87, 87, 87, 88, 88, 88, 88, 88,   // 240
+   88, 89, 89, 89, 90, 90, 90, 90    // 248
+};
+
+#endif                                 // ADC_TABLES_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
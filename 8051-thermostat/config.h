@@ -0,0 +1,35 @@
+//-----------------------------------------------------------------------------
+// config.h
+//-----------------------------------------------------------------------------
+//
+// Settings for the modules in common/, as built into the thermostat. The
+// build puts this directory on the include path ahead of common/.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Only the control unit talks to the thermostat, one frame every few seconds
+#define UART_RX_RINGSIZE  64
+
+// Escaped API mode; see XBEE_TX_WORST in xbee.h for why and for the slot size
+#define XBEE_AP            2
+#define UART_TX_FRAMESIZE  26
+
+// ADC1 sample rate within a burst of readings. Timer3 starts a conversion
+// on every overflow, and Clock_Set reloads it so the rate holds at either
+// clock speed.
+#define SAMPLE_RATE          50000     // Sample frequency in Hz
+#define CLOCK_TIMER3_COUNTS  (SYSCLK/12/SAMPLE_RATE)
+
+// The LCD queue sends one transaction every LCD_EXEC_US, on each Timer4
+// overflow. Clock_Set reloads Timer4 as well, so the pace holds too.
+#define LCD_EXEC_US          50
+#define CLOCK_TIMER4_COUNTS  TICK_COUNTS(LCD_EXEC_US)
+
+#endif                                 // CONFIG_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -1,54 +1,89 @@
 //LCD Functions Developed by electroSome
 
 //LCD Module Connections
-extern bit RS;                                                                   
-extern bit EN;                           
-extern bit D0;
-extern bit D1;
-extern bit D2;
-extern bit D3;
-extern bit D4;
-extern bit D5;
-extern bit D6;
-extern bit D7;
-//End LCD Module Connections 
-
-
-void Lcd_Delay(int a)
-{
-    int j;
-    int i;
-    for(i=0;i<a;i++)
-    {
-        for(j=0;j<100;j++)
-        {
-        }
-    }
-}
+// RS, EN and D0-D7 are declared with SBIT by the file that includes this
+// header, before the #include, along with RW unless LCD_TIMED is defined.
+// If D0-D7 are bits 0-7 of one port, in order, and the LCD has that port to
+// itself, LCD_DATA_SFR gives its address instead of the D0-D7 sbits. The
+// sbits are then declared here, and the bus is written a byte at a time
+// with a plain store to the whole port, so any other pin on it would be
+// overwritten. The port must be bit-addressable (P0-P3), for D7's sbit.
 
-//LCD 8 Bit Interfacing Functions
+#ifdef LCD_DATA_SFR
+#if (LCD_DATA_SFR & 0x07) != 0
+#error "LCD_DATA_SFR must be a bit-addressable port"
+#endif
+SFR (LCD_DATA_PORT, LCD_DATA_SFR);
+SBIT (D0, LCD_DATA_SFR, 0);
+SBIT (D1, LCD_DATA_SFR, 1);
+SBIT (D2, LCD_DATA_SFR, 2);
+SBIT (D3, LCD_DATA_SFR, 3);
+SBIT (D4, LCD_DATA_SFR, 4);
+SBIT (D5, LCD_DATA_SFR, 5);
+SBIT (D6, LCD_DATA_SFR, 6);
+SBIT (D7, LCD_DATA_SFR, 7);
+#endif
+//End LCD Module Connections
+
+// Every write waits for the HD44780 to finish the one before it, in one of
+// two ways chosen at compile time:
+//
+//    default     R/W is wired, and the busy flag is read back on D7 until
+//                the controller is ready, so each write costs only as long
+//                as the controller actually takes. The controller drives
+//                all of D0-D7 while it is read, the busy flag and the
+//                address counter, so the includer provides
+//                LCD_DATA_INPUT() and LCD_DATA_OUTPUT() to switch every
+//                data line to open-drain and back to push-pull.
+//    LCD_TIMED   R/W is tied low, and the worst-case execution time of each
+//                instruction is counted off in Timer4 ticks.
+//
+// Everything goes to the display through the queue further down, which
+// hands the waiting to Timer4. There are no blocking writes.
+//
+// Lcd8_Init only queues the power-on reset sequence and returns, so start-up
+// carries on while Timer4 sends it once interrupts are on. The sequence is
+// timed in both modes, since the busy flag cannot be read until it is done.
+
+#ifndef LCD_EXEC_US
+#define LCD_EXEC_US    50    // most instructions and data writes, 37 us typ.
+#endif
+#define LCD_CLEAR_US   2000  // clear display and return home, 1.52 ms typ.
+
+// Busy flag polls, one a tick, before the queue gives up and writes anyway,
+// so a missing R/W wire makes the display slow instead of freezing it: a
+// clear and some margin
+#define LCD_BUSY_TICKS (LCD_CLEAR_US / LCD_EXEC_US + 10)
+
+// E must stay high for at least 230 ns, 5 SYSCLKs at 22.1184 MHz
+#define Lcd_Strobe()   { EN = 1; NOP(); NOP(); NOP(); EN = 0; }
+
+#ifdef LCD_DATA_SFR
+// D0-D7 are bits 0-7 of the port, so the whole bus is a single write
+#define Lcd8_Port(a)   (LCD_DATA_PORT = (a))
+#else
 void Lcd8_Port(char a)
 {
 	if(a & 1)
 		D0 = 1;
-	else 
+	else
 		D0 = 0;
-	
+
 	if(a & 2)
 		D1 = 1;
 	else
 		D1 = 0;
-	
+
 	if(a & 4)
 		D2 = 1;
 	else
 		D2 = 0;
-	
+
 	if(a & 8)
 		D3 = 1;
 	else
 		D3 = 0;
-	
+
 	if(a & 16)
 		D4 = 1;
 	else
@@ -58,71 +93,265 @@ void Lcd8_Port(char a)
 		D5 = 1;
 	else
 		D5 = 0;
-	
+
 	if(a & 64)
 		D6 = 1;
-	else 
+	else
 		D6 = 0;
-	
+
 	if(a & 128)
 		D7 = 1;
 	else
 		D7 = 0;
 }
-void Lcd8_Cmd(char a)
-{ 
-  RS = 0;             // => RS = 0
-  Lcd8_Port(a);             //Data transfer
-  EN  = 1;             // => E = 1
-  Lcd_Delay(5);
-  EN  = 0;             // => E = 0
+#endif
+
+#ifndef LCD_TIMED
+// Reads the busy flag once; 1 while the last instruction is still running
+bit Lcd8_Busy(void)
+{
+	bit busy;
+
+	LCD_DATA_INPUT();
+	Lcd8_Port(0xFF);    // release all eight lines for the LCD to drive
+	RS = 0;
+	RW = 1;             // read busy flag and address
+	EN = 1;
+	NOP(); NOP(); NOP();   // data out valid 160 ns after E rises
+	busy = D7;
+	EN = 0;
+	RW = 0;
+	LCD_DATA_OUTPUT();
+
+	return busy;
 }
+#endif
+
+// Shadow frame buffer. The application draws into Lcd_Buf with the
+// Lcd8_Buf_ functions, which never touch the bus, and Lcd8_Flush queues only
+// the cells that differ from Lcd_Shown, what is on the glass or already
+// queued for it. A run of changed cells costs one cursor set and then one
+// write per cell, using the controller's auto-increment. Rows are
+// numbered from 1 and columns from 0.
+#define LCD_ROWS  2
+#define LCD_COLS  16
 
-Lcd8_Clear()
+unsigned char SEG_XDATA Lcd_Buf[LCD_ROWS][LCD_COLS];
+unsigned char SEG_XDATA Lcd_Shown[LCD_ROWS][LCD_COLS];
+
+// Both buffers blank, as the display is right after Lcd8_Clear
+void Lcd8_Buf_Clear()
 {
-	  Lcd8_Cmd(1);
+	unsigned char i;
+	for(i=0;i<LCD_COLS;i++)
+	{
+		Lcd_Buf[0][i] = Lcd_Shown[0][i] = ' ';
+		Lcd_Buf[1][i] = Lcd_Shown[1][i] = ' ';
+	}
 }
 
-void Lcd8_Set_Cursor(char a, char b)
+// Command queue. Lcd8_Queue_Cmd and Lcd8_Queue_Char put one transaction in
+// a ring and return at once; Lcd_Timer4_ISR sends one per Timer4 overflow,
+// every LCD_EXEC_US, so the superloop keeps reading the radio and the dial
+// while the display is redrawn. Both return 0 without queueing anything
+// when the ring is full, and Lcd8_Queue_Free says how much room is left.
+// Lcd_Queue_Done is 1 once everything queued has been sent and executed.
+//
+// Timer4 only runs while there is something to send. Each tick the ISR
+// first makes sure the controller is ready, by one read of the busy flag
+// or, with LCD_TIMED, by counting out the ticks a clear still needs. A busy
+// flag still set after LCD_BUSY_TICKS reads is ignored, as in Lcd8_Wait.
+//
+// Lcd8_Queue_Wait queues a pause instead of a transaction, for timing the
+// controller cannot report. A pause is taken from the queue without a look
+// at the busy flag, and so is the transaction after it, as the pause stands
+// in for that. Lcd_Queue_Paused starts out set, so the flag is not read
+// before the power-on sequence has gone out either.
+#ifndef LCD_QUEUE_SIZE
+#define LCD_QUEUE_SIZE 32              // must be a power of 2
+#endif
+#define LCD_QUEUE_MASK (LCD_QUEUE_SIZE - 1)
+
+unsigned char SEG_XDATA Lcd_Queue[LCD_QUEUE_SIZE];
+unsigned char SEG_XDATA Lcd_Queue_RS[LCD_QUEUE_SIZE];   // or LCD_QUEUE_WAIT
+volatile unsigned char Lcd_Queue_Head = 0;   // next free slot, moved by main
+volatile unsigned char Lcd_Queue_Tail = 0;   // next to send, moved by the ISR
+volatile unsigned char Lcd_Queue_Done = 1;
+unsigned char Lcd_Queue_Wait = 0;            // ticks left of a pause or clear
+unsigned char Lcd_Queue_Polls = 0;           // busy flag reads for this entry
+bit Lcd_Queue_Paused = 1;                    // the last entry was a pause
+
+#define LCD_QUEUE_WAIT 2       // entry is a pause of that many ticks
+
+#define Lcd8_Queue_Free() \
+	(LCD_QUEUE_MASK - ((Lcd_Queue_Head - Lcd_Queue_Tail) & LCD_QUEUE_MASK))
+
+//LCD 8 Bit Interfacing Functions
+// Queues RS and one byte for Lcd_Timer4_ISR, or with <rs> LCD_QUEUE_WAIT a
+// pause of <a> ticks; 0 if the ring is full
+unsigned char Lcd8_Queue(char a, unsigned char rs)
 {
-	if(a == 1)
-	  Lcd8_Cmd(0x80 + b);
-	else if(a == 2)
-		Lcd8_Cmd(0xC0 + b);
+	unsigned char head = Lcd_Queue_Head;
+
+	if (((head + 1) & LCD_QUEUE_MASK) == Lcd_Queue_Tail)
+	{
+		return 0;
+	}
+
+	Lcd_Queue[head] = a;
+	Lcd_Queue_RS[head] = rs;
+
+	EIE2 &= ~0x04;      // keep the ISR out while it may be going idle
+	Lcd_Queue_Head = (head + 1) & LCD_QUEUE_MASK;
+	Lcd_Queue_Done = 0;
+	T4CON |= 0x04;      // TR4
+	EIE2 |= 0x04;
+
+	return 1;
 }
 
+#define Lcd8_Queue_Cmd(a)   Lcd8_Queue((a), 0)
+#define Lcd8_Queue_Char(a)  Lcd8_Queue((a), 1)
+
+// A pause of at least <us>, up to 255 ticks of LCD_EXEC_US (12.75 ms)
+#define Lcd8_Queue_Wait(us) \
+	Lcd8_Queue(((us) + LCD_EXEC_US - 1) / LCD_EXEC_US, LCD_QUEUE_WAIT)
+
 void Lcd8_Init()
 {
+	RS = 0;             // all come out of reset high; RS first, so the
+	EN = 0;             // falling edge of EN is not taken as a data write
+#ifndef LCD_TIMED
+	RW = 0;
+#endif
 	Lcd8_Port(0x00);
-	RS = 0;
-	Lcd_Delay(200);
+	Lcd8_Buf_Clear();
+
+	// Timer4 for the queue: SYSCLK/12, auto-reload every LCD_EXEC_US,
+	// stopped until something is queued. This is the full-speed reload;
+	// Clock_Set rescales it with CLOCK_TIMER4_COUNTS from config.h.
+	CKCON &= ~0x40;
+	T4CON = 0x00;
+	RCAP4 = -TICK_COUNTS(LCD_EXEC_US);
+	T4 = RCAP4;
+	EIE2 |= 0x04;       // ET4
+
 	///////////// Reset process from datasheet /////////
-  Lcd8_Cmd(0x30);
-	Lcd_Delay(50);
-  Lcd8_Cmd(0x30);
-	Lcd_Delay(110);
-  Lcd8_Cmd(0x30);
-  /////////////////////////////////////////////////////
-  Lcd8_Cmd(0x38);    //function set
-  Lcd8_Cmd(0x0C);    //display on,cursor off,blink off
-  Lcd8_Cmd(0x01);    //clear display
-  Lcd8_Cmd(0x06);    //entry mode, set increment
+	Lcd8_Queue_Wait(7500);            // >15 ms after power on
+	Lcd8_Queue_Wait(7500);
+	Lcd8_Queue_Cmd(0x30);
+	Lcd8_Queue_Wait(4100);            // >4.1 ms
+	Lcd8_Queue_Cmd(0x30);
+	Lcd8_Queue_Wait(100);             // >100 us
+	Lcd8_Queue_Cmd(0x30);
+	Lcd8_Queue_Wait(LCD_EXEC_US);
+	/////////////////////////////////////////////////////
+	Lcd8_Queue_Cmd(0x38);    //function set
+	Lcd8_Queue_Cmd(0x0C);    //display on,cursor off,blink off
+	Lcd8_Queue_Cmd(0x01);    //clear display
+	Lcd8_Queue_Cmd(0x06);    //entry mode, set increment
 }
 
-void Lcd8_Write_Char(char a)
+void Lcd8_Buf_Write_Char(unsigned char row, unsigned char col, char a)
 {
-   RS = 1;             // => RS = 1
-   Lcd8_Port(a);             //Data transfer
-   EN  = 1;             // => E = 1
-   Lcd_Delay(5);
-   EN  = 0;             // => E = 04
+	Lcd_Buf[row - 1][col] = a;
 }
 
-void Lcd8_Write_String(char *a)
+void Lcd8_Buf_Write_String(unsigned char row, unsigned char col, const char *a)
 {
-	int i;
-	for(i=0;a[i]!='\0';i++)
-	 Lcd8_Write_Char(a[i]);
+	unsigned char SEG_XDATA *cell = &Lcd_Buf[row - 1][col];
+	while(*a != '\0' && col++ < LCD_COLS)
+	 *cell++ = *a++;
+}
+
+// Queues the changed cells. Returns 0 if the queue filled up first, in
+// which case calling it again later queues the rest.
+unsigned char Lcd8_Flush()
+{
+	unsigned char row;
+	unsigned char col;
+	unsigned char c;
+	bit cursor;         // the controller's address is already at this cell
+
+	for(row=0;row<LCD_ROWS;row++)
+	{
+		cursor = 0;
+		for(col=0;col<LCD_COLS;col++)
+		{
+			c = Lcd_Buf[row][col];
+			if(c == Lcd_Shown[row][col])
+			{
+				cursor = 0;
+				continue;
+			}
+			if(!cursor)
+			{
+				if(Lcd8_Queue_Free() < 2)
+				{
+					return 0;       // no room for the address and a cell
+				}
+				Lcd8_Queue_Cmd((row ? 0xC0 : 0x80) + col);
+				cursor = 1;
+			}
+			if(!Lcd8_Queue_Char(c))
+			{
+				return 0;
+			}
+			Lcd_Shown[row][col] = c;
+		}
+	}
+
+	return 1;
+}
+
+// Sends the next queued transaction once the controller is ready for it
+INTERRUPT (Lcd_Timer4_ISR, INTERRUPT_TIMER4)
+{
+	unsigned char tail;
+
+	T4CON &= ~0x80;     // TF4 is not cleared by hardware
+
+	if (Lcd_Queue_Wait)
+	{
+		Lcd_Queue_Wait--;
+		return;
+	}
+
+	tail = Lcd_Queue_Tail;
+	if (tail == Lcd_Queue_Head)
+	{
+		T4CON &= ~0x04;  // Lcd8_Queue starts it again
+		Lcd_Queue_Done = 1;
+		return;
+	}
+
+	if (Lcd_Queue_RS[tail] == LCD_QUEUE_WAIT)
+	{
+		Lcd_Queue_Tail = (tail + 1) & LCD_QUEUE_MASK;
+		Lcd_Queue_Wait = Lcd_Queue[tail];
+		Lcd_Queue_Paused = 1;
+		return;
+	}
+#ifndef LCD_TIMED
+	if (!Lcd_Queue_Paused && Lcd8_Busy() &&
+	    ++Lcd_Queue_Polls < LCD_BUSY_TICKS)
+	{
+		return;
+	}
+	Lcd_Queue_Polls = 0;
+#endif
+	Lcd_Queue_Tail = (tail + 1) & LCD_QUEUE_MASK;
+	Lcd_Queue_Paused = 0;
+
+	RS = Lcd_Queue_RS[tail];
+	Lcd8_Port(Lcd_Queue[tail]);
+	Lcd_Strobe();
+#ifdef LCD_TIMED
+	if (!Lcd_Queue_RS[tail] && Lcd_Queue[tail] <= 0x03)
+	{
+		Lcd_Queue_Wait = LCD_CLEAR_US / LCD_EXEC_US;
+	}
+#endif
 }
 
 //End LCD 8 Bit Interfacing Functions
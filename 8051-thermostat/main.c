@@ -18,9 +18,10 @@
 // The thermostat has a potentiometer (dial) that allows the user to set
 // the desired room temperature. Both the TMP36 and potentiometer are
 // wired to use ADC1 on the 8051. This requires using the ADC1 multiplex
-// selector to choose the appropriate AN1 input pin. We use a timer to
-// interrupt at a set interval to check the ADC1 value, and toggle between
-// the two ADC1 inputs using the ADC1 multiplex selector register.
+// selector to choose the appropriate AN1 input pin. Timer3 starts an ADC1
+// conversion at a fixed rate, and the end-of-conversion interrupt adds each
+// result to the sum for its input and moves the multiplex selector on to
+// the next input in a table.
 //
 // An LCD display unit is the primary output device for the user. It is a
 // 16x2 display unit. It shows the average temperature as reported by the
@@ -60,82 +61,123 @@
 // Includes
 //-----------------------------------------------------------------------------
 
-#include <c8051f020.h>                 // SFR declarations
 #include <compiler_defs.h>
+#include <C8051F020_defs.h>            // SFR declarations
 #include <stdio.h>
-#include "lcd.h"					   // Adding this library for LCD control
-
-//-----------------------------------------------------------------------------
-// 16-bit SFR Definitions for 'F02x
-//-----------------------------------------------------------------------------
-
-sfr16 ADC0     = 0xbe;                 // ADC0 data
-sfr16 RCAP2    = 0xca;                 // Timer2 capture/reload
-sfr16 RCAP3    = 0x92;                 // Timer3 capture/reload
-sfr16 TMR2     = 0xcc;                 // Timer2
-sfr16 TMR3     = 0x94;                 // Timer3
+#include "config.h"                    // Settings for the common modules
+#include "clock.h"                     // Crystal oscillator and SYSCLK
+#include "uart.h"                      // UART1 link to the XBee
+#include "xbee.h"                      // XBee API framing
+#include "timer.h"                     // System tick and software timers
+
+//LCD Module Connections (must come before lcd.h, which uses them)
+SBIT (RS, SFR_P1, 0);
+SBIT (EN, SFR_P1, 2);
+#define LCD_DATA_SFR SFR_P2    // D0-D7 are P2.0-P2.7, and nothing else is on P2
+
+// R/W is on P1.3 so the LCD driver can poll the busy flag. Build with
+// LCD_TIMED defined for a board with R/W tied low.
+#ifndef LCD_TIMED
+SBIT (RW, SFR_P1, 3);
+#define LCD_DATA_INPUT()  (P2MDOUT = 0x00)
+#define LCD_DATA_OUTPUT() (P2MDOUT = 0xFF)
+#endif
+
+SBIT (AM2302, SFR_P1, 7);
 
-//LCD Module Connections
-sbit RS = P1^0;                                                                   
-sbit EN = P1^2;                            
-sbit D0 = P2^0;
-sbit D1 = P2^1;
-sbit D2 = P2^2;
-sbit D3 = P2^3;
-sbit D4 = P2^4;
-sbit D5 = P2^5;
-sbit D6 = P2^6;
-sbit D7 = P2^7;
-
-sbit AM2302 = P1^7;
+#include "lcd.h"					   // Adding this library for LCD control
+#include "adc_tables.h"                // ADC1 code to temp and set point
 
 //-----------------------------------------------------------------------------
 // Global Constants
 //-----------------------------------------------------------------------------
 
-#define BAUDRATE     9600	           // Baud rate of UART in bps
-#define SYSCLK       22118400          // External crystal oscillator frequency
-#define SAMPLE_RATE  50000             // Sample frequency in Hz
-#define INT_DEC      256               // Integrate and decimate ratio
+// Integrate and decimate ratio: ADC1 samples added up per reading of each
+// input, 16 to 256 in powers of 2. Every reading is scaled to a 12-bit
+// code, 16 per 8-bit step, whatever the ratio, so the conversions below do
+// not depend on it; 256 samples really do give 4 more bits once the noise
+// is averaged out.
+#ifndef INT_DEC
+#define INT_DEC      256
+#endif
+
+#if INT_DEC == 256
+#define DEC_SHIFT    4
+#elif INT_DEC == 128
+#define DEC_SHIFT    3
+#elif INT_DEC == 64
+#define DEC_SHIFT    2
+#elif INT_DEC == 32
+#define DEC_SHIFT    1
+#elif INT_DEC == 16
+#define DEC_SHIFT    0
+#else
+#error INT_DEC must be a power of 2 from 16 to 256
+#endif
+
+// ADC1 scan table: the AIN1 inputs converted in turn, one per sample, and
+// the slot of Scan_Code each one ends up in. A sensor on a spare AIN1 pin
+// (P1.4 or P1.5) needs an entry here, a slot number, and its pin made an
+// analog input in PORT_Init. The inputs are sampled in bursts of INT_DEC
+// passes through the table, SCAN_COUNT * INT_DEC / SAMPLE_RATE s long,
+// 10 ms with two inputs. Each redraw starts the next one.
+#define SCAN_TEMP    0                 // AIN1.6, the TMP36
+#define SCAN_DIAL    1                 // AIN1.1, the set-point dial
+#define SCAN_COUNT   2
+
+static unsigned char SEG_CODE Scan_Channels[SCAN_COUNT] = { 0x06, 0x01 };
+
+#define SAR_CLK      2500000            // ADC1 conversion clock, at most
 
 #define SAMPLE_DELAY 150                // Delay in ms before taking sample
+#define TX_PERIOD    1800               // ms between transmits to the A/C
+
+// Flashes of the status LEDs at start-up, to show the thing is running; 0
+// for none. They run alongside everything else, off software timer 1.
+#ifndef LED_SELF_TEST
+#define LED_SELF_TEST 10
+#endif
+#define SELF_TEST_PERIOD 50             // ms the LEDs stay on or off
 
 //-----------------------------------------------------------------------------
 // Function Prototypes
 //-----------------------------------------------------------------------------
 
-void OSCILLATOR_Init (void);           
 void PORT_Init (void);
-void UART1_Init (void);
 void ADC1_Init (void);
-void TIMER3_Init (int counts);
-void Timer3_ISR ();
-void Wait (unsigned int ms, short us);
-void TransmitData (void);
+void TIMER3_Init (unsigned int counts);
+INTERRUPT_PROTO (ADC1_ISR, INTERRUPT_ADC1_EOC);
+void GetAnalogReadings (void);
+void TransmitData (void);
+void Transmit_Callback (void);
+void SelfTest_Callback (void);
 //void GetExternalReadings (void);
-void GetDigits (float measurement, int * digit1, int * digit2);
+void GetDigits (unsigned char value, unsigned char * digit1,
+                unsigned char * digit2);
+void Superloop (void);
 
 //-----------------------------------------------------------------------------
 // Global Variables
 //-----------------------------------------------------------------------------
 
-#define UART_RX_BUFFERSIZE 20
-unsigned char UART_Rx_Buffer[UART_RX_BUFFERSIZE];
-unsigned char UART_Rx_Buffer_Size = 0;
-unsigned char UART_Rx_Input_First = 0;
-unsigned char UART_Rx_Output_First = 0;
+unsigned char Dial_Reading;
+unsigned char Temp_Reading;
 
-#define UART_TX_BUFFERSIZE 20
-unsigned char UART_Tx_Buffer[UART_TX_BUFFERSIZE];
-unsigned char UART_Tx_Buffer_Size = 0;
-unsigned char UART_Tx_Output_First = 0;
+// Decimated 12-bit codes from ADC1_ISR, one per scan table entry, and 1
+// while they are unread
+volatile unsigned int Scan_Code[SCAN_COUNT];
+volatile unsigned char Codes_Ready = 0;
 
-unsigned char TX_Ready = 1;
-static char Byte;
-unsigned char Dial_Reading;
-unsigned char Temp_Reading;
+unsigned int Scan_Sum[SCAN_COUNT];     // samples so far of each input
+unsigned char Scan_Index = 0;          // entry the conversion under way is on
+unsigned char Scan_Rounds = 0;         // passes through the table so far
 
-float internal_temp = 0.0;
+unsigned short averageTemp = 0;        // from the last control unit frame
+unsigned short controlUnitState = 0x00;
+unsigned int nextSample = 0;           // tick of the next LCD redraw
+unsigned char lcdQueued = 1;           // 0 while a redraw waits for room
+unsigned char selfTestLeft = 2 * LED_SELF_TEST;   // LED toggles still to go
+unsigned char transmitting = 0;        // 1 once the first readings are in
 
 //-----------------------------------------------------------------------------
 // main() Routine
@@ -143,105 +185,142 @@ float internal_temp = 0.0;
 
 void main (void)
 {
-	int j = 0;
-
-	int digit1 = 0;
-	int digit2 = 0;
-
-	unsigned short averageTemp = 0;
-	unsigned short controlUnitState = 0x00;
-
 	WDTCN = 0xDE;                       // Disable watchdog timer
 	WDTCN = 0xAD;
 
-	OSCILLATOR_Init ();                 // Initialize oscillator
+	// What does not depend on SYSCLK is done while the crystal settles
+	OSCILLATOR_Start ();                // Start the crystal
 	PORT_Init ();                       // Initialize crossbar and GPIO
-	UART1_Init ();                      // Initialize UART1 for ZigBee
-	Lcd8_Init();						// Initialize LCD in 8bit mode
+	OSCILLATOR_Init ();                 // Switch to the crystal
+
+	UART1_Init ();                      // Initialize UART1 for ZigBee
+	Tick_Init ();                       // Start the 1 ms system tick
+	Lcd8_Init();						// Queue the LCD's 8bit mode init
 
-	// Timer 3 is used for ADC1
-	TIMER3_Init (SYSCLK/12/10);   // Initialize Timer3 to overflow at
-	                              // sample rate
+	// Timer 3 starts the ADC1 conversions
+	TIMER3_Init (CLOCK_TIMER3_COUNTS);     // Initialize Timer3 to overflow
+	                                       // at SAMPLE_RATE (config.h)
 
 	ADC1_Init ();                       // Init ADC
 
 	EA = 1;                             // Enable global interrupts
 
-	P5 = P5 & 0xFF;
+	P5 &= ~0xF0;                        // Status LEDs off
 
-	// Flash the LEDs on bootup for visual conf that the thing is running
-	for ( j = 0; j < 10; j++) 
-	{
-		Wait(50, 0);
-		P5 |= 0xF0;
-		Wait(50, 0);
-	  	P5 = 0x00;
-	}
+	// Flash the LEDs on bootup for visual conf that the thing is running,
+	// while the LCD comes up and the first readings come in
+#if LED_SELF_TEST
+	Timer_Start (1, SELF_TEST_PERIOD, SELF_TEST_PERIOD, SelfTest_Callback);
+#endif
+
+	nextSample = Tick_Now();
+
+	// Run at half speed from here on; only the redraw needs the full clock
+	Clock_Set (CLOCK_HALF);
 
-	j = 0;
+	Tick_Ready ();
 
+	// Every pass ends in IDLE; the next UART byte, tick, ADC1 sample or
+	// LCD transaction wakes the CPU for another
 	while (1)
 	{
-		//EA = 0;
+		Superloop ();
+		Tick_Idle ();
+	}
+}
 
-		// Write the initial text into the LCD display. maybe need to put in second c file.
-		Lcd8_Set_Cursor(1,1);
-		Lcd8_Write_String("Temp: ");
-		Lcd8_Set_Cursor(1,7);
-
-		GetDigits((float)averageTemp, &digit1, &digit2);
-
-		Lcd8_Write_Char(digit1 + 48);
-		Lcd8_Set_Cursor(1,8);
-		Lcd8_Write_Char(digit2 + 48);
+//-----------------------------------------------------------------------------
+// Superloop
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// One pass of the main loop: reads any frames from the control unit, runs
+// the software timers that are due, and every SAMPLE_DELAY ms redraws the
+// LCD and the status LEDs. The redraw is only queued; Timer4 sends it to
+// the LCD while later passes carry on.
+//
+//-----------------------------------------------------------------------------
 
-		if (controlUnitState & 0x01)
-		{
-			Lcd8_Set_Cursor(1,13);
-			Lcd8_Write_String("ON ");			
-		}
-		else
+void Superloop (void)
+{
+	unsigned char digit1 = 0;
+	unsigned char digit2 = 0;
+
+	// Check for ZigBee Rx Packet API frames from the control unit that
+	// carry the average temp and the unit state, and read both bytes
+	while (XBee_Receive())
+	{
+		if (XBee_Frame[0] == XBEE_API_RX_PACKET &&
+			XBee_Frame_Length == XBEE_RX_DATA + 2)
 		{
-			Lcd8_Set_Cursor(1,13);
-			Lcd8_Write_String("OFF");			
+			// Assign the control unit's computed temp average to a variable
+			averageTemp = XBee_Frame[XBEE_RX_DATA];
+			controlUnitState = XBee_Frame[XBEE_RX_DATA + 1];
 		}
+	}
 
-		Lcd8_Set_Cursor(2,1);
-		Lcd8_Write_String("Set: ");
-
-		GetDigits((float)Dial_Reading, &digit1, &digit2);
-
-		Lcd8_Set_Cursor(2,7);
-		Lcd8_Write_Char(digit1 + 48);
-		Lcd8_Set_Cursor(2,8);
-		Lcd8_Write_Char(digit2 + 48);
-		
+	Timer_Service();
 
-		if (controlUnitState & 0x02)
-		{
-			Lcd8_Set_Cursor(2,13);
-			Lcd8_Write_String("NC");			
-		}
-		else
-		{
-			Lcd8_Set_Cursor(2,13);
-			Lcd8_Write_String("  ");			
-		}
+	GetAnalogReadings();
 
-		// Check for a ZigBee Rx Packet API frame that contains a combo set/actual temp pair, 
-		// and if it is, read the first two bytes
-		if (UART_Rx_Buffer_Size == 18 && UART_Rx_Buffer[0] == 0x7E && UART_Rx_Buffer[3] == 0x90)
-		{
-			// Assign the control unit's computed temp average to a variable
-			averageTemp = UART_Rx_Buffer[15];
-			controlUnitState = UART_Rx_Buffer[16];
-			UART_Rx_Buffer_Size = 0; // reset buffer
-		}
-		else 
-		{
-			UART_Rx_Buffer_Size = 0;
-		}
+	// Finish queueing a redraw that did not all fit in the LCD queue
+	if (!lcdQueued)
+	{
+		lcdQueued = Lcd8_Flush();
+	}
+
+	// Redraw the LCD and the status LEDs every SAMPLE_DELAY ms
+	if (!Tick_Expired(nextSample))
+	{
+		return;
+	}
+
+	nextSample += SAMPLE_DELAY;
+
+	// Sample the inputs again, for the next redraw
+	TMR3CN |= 0x04;                     // Start Timer3, TR3
+
+	// Draw the screen into the LCD frame buffer; Lcd8_Flush then queues the
+	// cells that changed since the last redraw, usually none or a digit
+	Lcd8_Buf_Write_String(1,1,"Temp: ");
+
+	GetDigits(averageTemp, &digit1, &digit2);
+
+	Lcd8_Buf_Write_Char(1,7,digit1 + 48);
+	Lcd8_Buf_Write_Char(1,8,digit2 + 48);
 
+	if (controlUnitState & 0x01)
+	{
+		Lcd8_Buf_Write_String(1,13,"ON ");
+	}
+	else
+	{
+		Lcd8_Buf_Write_String(1,13,"OFF");
+	}
+
+	Lcd8_Buf_Write_String(2,1,"Set: ");
+
+	GetDigits(Dial_Reading, &digit1, &digit2);
+
+	Lcd8_Buf_Write_Char(2,7,digit1 + 48);
+	Lcd8_Buf_Write_Char(2,8,digit2 + 48);
+
+	if (controlUnitState & 0x02)
+	{
+		Lcd8_Buf_Write_String(2,13,"NC");
+	}
+	else
+	{
+		Lcd8_Buf_Write_String(2,13,"  ");
+	}
+
+	lcdQueued = Lcd8_Flush();
+
+	// The status LEDs are the self-test's until it is over
+	if (!selfTestLeft)
+	{
 		// Check the control unit state for whether the A/C unit is
 		// on and cooling the room or off
 		if (controlUnitState & 0x01) 
@@ -257,7 +336,7 @@ void main (void)
 		if (controlUnitState & 0x02)
 		{
 			P5 &= ~0x20;
-			
+		
 			// this condition will get hit over and over so let's not
 			// keep sounding the buzzer each time. Do it once.
 			//if (shouldBuzzOnEmpty) 
@@ -273,20 +352,6 @@ void main (void)
 			// activate the buzzer
 			//shouldBuzzOnEmpty = 1;
 		}
-
-		if(TX_Ready == 1 && j == 0)
-		{	
-			//GetExternalReadings();
-			TransmitData();
-			UART_Tx_Buffer_Size = 0;
-		}
-
-		j++;
-
-		if (j == 12) j = 0;
-
-		Wait(150, 0);           // Wait some time before taking
-                                       // another sample
 	}
 }
 
@@ -294,35 +359,6 @@ void main (void)
 // Initialization Subroutines
 //-----------------------------------------------------------------------------
 
-//-----------------------------------------------------------------------------
-// OSCILLATOR_Init
-//-----------------------------------------------------------------------------
-//
-// Return Value : None
-// Parameters   : None
-//
-// This routine initializes the system clock to use an 22.1184MHz crystal
-// as its clock source.
-//
-//
-//-----------------------------------------------------------------------------
-void OSCILLATOR_Init (void)
-{
-   int i;                              // delay counter
-
-   OSCXCN = 0x67;                      // start external oscillator with
-                                       // 22.1184MHz crystal
-
-   for (i=0; i < 256; i++) ;           // wait for oscillator to start
-
-   while (!(OSCXCN & 0x80)) ;          // Wait for crystal osc. to settle
-
-   OSCICN = 0x88;                      // select external oscillator as SYSCLK
-                                       // source and enable missing clock
-                                       // detector
-
-}
-
 //-----------------------------------------------------------------------------
 // PORT_Init
 //-----------------------------------------------------------------------------
@@ -342,7 +378,7 @@ void PORT_Init (void)
 
    P0MDOUT |= 0x04;     		// Set UART TX pins to push-pull on port 0
 
-	P1MDOUT |= 0x07;
+	P1MDOUT |= 0x0D; // LCD RS, EN and R/W; P1.1 is the dial (analog)
 	P1MDOUT |= 0x80; // AM2302 P1^7
 
    	P2MDOUT = 0xFF;
@@ -364,43 +400,6 @@ void PORT_Init (void)
 
 }
 
-//-----------------------------------------------------------------------------
-// UART1_Init
-//-----------------------------------------------------------------------------
-//
-// Return Value : None
-// Parameters   : None
-//
-// Configure the UART1 using Timer1, for <baudrate> and 8-N-1.
-// This routine configures the UART1 based on the following equation:
-//
-// Baud = (2^SMOD1/32)*(SYSTEMCLOCK*12^(T1M-1))/(256-TH1)
-//
-// This equation can be found in the datasheet, Mode1 baud rate using timer1.
-// The function select the proper values of the SMOD1 and T1M bits to allow
-// for the proper baud rate to be reached.
-//-----------------------------------------------------------------------------
-void UART1_Init (void)
-{
-   SCON1   = 0x50;                     // SCON1: mode 1, 8-bit UART, enable RX
-
-   TMOD   &= ~0xF0;
-   TMOD   |=  0x20;                    // TMOD: timer 1, mode 2, 8-bit reload
-
-   PCON |= 0x10;                    // SMOD1 (PCON.4) = 1 --> UART1 baudrate
-                                       // divide-by-two disabled
-   CKCON |= 0x10;                   // Timer1 uses the SYSTEMCLOCK
-   TH1 = - ((SYSCLK/BAUDRATE)/16);
-
-   TL1 = TH1;                          // init Timer1
-   TR1 = 1;                            // START Timer1
-   TX_Ready = 1;                       // Flag showing that UART can transmit
-   EIE2     = 0x40;                    // Enable UART1 interrupts
-
-   EIP2    = 0x40;                     // Make UART high priority
-
-}
-
 //-----------------------------------------------------------------------------
 // TIMER3_Init
 //-----------------------------------------------------------------------------
@@ -411,7 +410,8 @@ void UART1_Init (void)
 //                    range is postive range of integer: 0 to 32767
 //
 // Configure Timer3 to auto-reload at interval specified by <counts> (no
-// interrupt generated) using SYSCLK as its time base.
+// interrupt generated) using SYSCLK/12 as its time base. Each overflow
+// starts an ADC1 conversion.
 //
 //-----------------------------------------------------------------------------
 void TIMER3_Init (unsigned int counts)
@@ -419,9 +419,8 @@ void TIMER3_Init (unsigned int counts)
 
    TMR3CN = 0x00;                      // Stop Timer3; Clear TF3; set sysclk
                                        // as timebase
-	TMR3RLL = -counts;
+	TMR3RL = -counts;
 	TMR3 = 0xFFFF;
-	EIE2 |= 0x01;
 	TMR3CN |= 0x04;
 }
 
@@ -429,42 +428,53 @@ void TIMER3_Init (unsigned int counts)
 // Interrupt Service Routines
 //-----------------------------------------------------------------------------
 
-void Timer3_ISR(void) interrupt 14
+//-----------------------------------------------------------------------------
+// ADC1_ISR
+//-----------------------------------------------------------------------------
+//
+// Adds each conversion to the sum of the scan table entry it was started
+// on, then points the multiplexer at the next entry. That conversion only
+// starts on the next Timer3 overflow, so the input has a whole sample
+// period to settle, and the result is always filed under the right entry
+// as long as this ISR gets to run before that overflow.
+//
+// After INT_DEC passes through the table every sum is decimated to a
+// 12-bit code in Scan_Code for GetAnalogReadings, and Timer3 is stopped
+// until the next redraw starts another burst. Sampling without a break
+// would wake the CPU 50,000 times a second for readings only looked at
+// every SAMPLE_DELAY ms.
+//
+//-----------------------------------------------------------------------------
+INTERRUPT (ADC1_ISR, INTERRUPT_ADC1_EOC)
 {
-	float temp = 0.0f;
-	float dial = 0.0f;
+	unsigned char i = Scan_Index;
 
-	TMR3CN &= ~(0x80);
+	ADC1CN &= ~0x20;                    // clear AD1INT
 
-	//while((ADC1CN & 0x20) == 0);	
+	Scan_Sum[i] += ADC1;
 
-	if (AMX1SL == 0x06)
+	if (++i == SCAN_COUNT)
 	{
-		//Temp_Reading = ADC1;
-		temp = ((float)ADC1 - 91.0f) * 1.8f;
-		Temp_Reading = (short)temp + 32;
-
-		// use ADC1 multiplex selector to switch back to other
-		// ADC input so next timer interrupt polls the other device
-		AMX1SL = 0x01; 
+		i = 0;
 
-	}
-	else
-	{
-		dial = (((float)ADC1) * 0.15686275) + 50;
-		//dial = ADC1;//(((float)ADC1 - 14.0f) * 0.1659751037) + 50;
+		if (++Scan_Rounds == (unsigned char)INT_DEC)   // 256 wraps to 0
+		{
+			Scan_Rounds = 0;
 
-		if (dial < 50.0f) dial = 50.0f;
-		else if (dial > 89.5f) dial = 90.0f;
+			do
+			{
+				Scan_Code[i] = Scan_Sum[i] >> DEC_SHIFT;
+				Scan_Sum[i] = 0;
+			} while (++i < SCAN_COUNT);
 
-		Dial_Reading = (short)dial;
-
-		// use ADC1 multiplexer to switch to other ADC input so next
-		// interrupt polls the other analog input device
-		AMX1SL = 0x06;
+			i = 0;
+			Codes_Ready = 1;
+			TMR3CN &= ~0x04;            // Stop Timer3, TR3
+		}
 	}
 
-	ADC1CN &= 0xDF;
+	AMX1SL = Scan_Channels[i];
+	Scan_Index = i;
 }
 
 //-----------------------------------------------------------------------------
@@ -479,202 +489,149 @@ void ADC1_Init (void)
 {
 	REF0CN = 0x03;
 
-	ADC1CF = 0x81;//(SYSCLK/SAR_CLK) << 3;     // ADC conversion clock = 2.5MHz
-   	//ADC1CF |= 0x00;
+	// SAR clock SYSCLK/(AD1SC + 1), gain 1. Halved at CLOCK_HALF, when a
+	// conversion still ends well inside the sample period.
+	ADC1CF = ((SYSCLK/SAR_CLK) << 3) | 0x01;
 
-	AMX1SL = 0x06;
-	ADC1CN = 0x82; // enable ADC interrupts
+	AMX1SL = Scan_Channels[0];
+	ADC1CN = 0x82; // enabled, conversions started by Timer3 overflows
+	EIE2 |= 0x08;  // ADC1 end-of-conversion interrupt
 }
 
 
 //-----------------------------------------------------------------------------
-// Interrupt Service Routines
+// Support Subroutines
 //-----------------------------------------------------------------------------
 
 //-----------------------------------------------------------------------------
-// UART1_Interrupt
+// GetAnalogReadings
 //-----------------------------------------------------------------------------
 //
-// This routine is invoked whenever a byte is received from UART or transmitted.
+// Return Value : None
+// Parameters   : None
+//
+// Converts the latest decimated codes from ADC1_ISR, if there are new ones,
+// to the room temp and the set point in F, with the tables generated into
+// adc_tables.h. The ADC1 interrupt is held off while both codes are copied,
+// so they always come from the same pass.
+//
+// A 12-bit code is an 8-bit table index and 4 bits of fraction. The temp
+// is interpolated between the two entries either side, as the TMP36 moves
+// 1.8 F per 8-bit step; the dial takes the nearest entry.
+//
+// The first readings, 10 ms or so after start-up, also start the periodic
+// transmit to the A/C, so it is never sent a set point of 0.
 //
 //-----------------------------------------------------------------------------
 
-void UART1_Interrupt (void) interrupt 20
+void GetAnalogReadings (void)
 {
-   if ((SCON1 & 0x01) == 0x01)
-   {
-      if( UART_Rx_Buffer_Size == 0)  
-	  {
-         UART_Rx_Input_First = 0; 
-	  } 
-
-      SCON1 = (SCON1 & 0xFE); 
-      Byte = SBUF1;            
-		
-      if (UART_Rx_Buffer_Size < UART_RX_BUFFERSIZE)
-      {
-         UART_Rx_Buffer[UART_Rx_Input_First] = Byte;  
-
-         UART_Rx_Buffer_Size++;            
-
-         UART_Rx_Input_First++;            
-      }
-   }
-
-   if ((SCON1 & 0x02) == 0x02)         
-   {
-      SCON1 = (SCON1 & 0xFD);
-      if (UART_Tx_Buffer_Size != 1)        
-      {
-         if ( UART_Tx_Buffer_Size == UART_Tx_Output_First )  
-         {
-            UART_Tx_Output_First = 0;
-         }
-
-         Byte = UART_Tx_Buffer[UART_Tx_Output_First];
-
-         SBUF1 = Byte;
-
-         UART_Tx_Output_First++;           // Update counter
-         UART_Tx_Buffer_Size--;            // Decrease array size
-      }
-      else
-      {
-         UART_Tx_Buffer_Size = 0;           // Set the array size to 0
-         TX_Ready = 1;                   // Indicate transmission complete
-      }
-   }
-}
+	unsigned int tempCode;
+	unsigned int dialCode;
+	unsigned int temp;
+	unsigned char step;
+	unsigned char fraction;
 
-//-----------------------------------------------------------------------------
-// Support Subroutines
-//-----------------------------------------------------------------------------
+	if (!Codes_Ready)
+	{
+		return;
+	}
+
+	EIE2 &= ~0x08;
+	tempCode = Scan_Code[SCAN_TEMP];
+	dialCode = Scan_Code[SCAN_DIAL];
+	Codes_Ready = 0;
+	EIE2 |= 0x08;
+
+	step = tempCode >> 4;
+	fraction = tempCode & 0x0F;
+	temp = Temp_Table[step];             // in 1/16 F
+
+	if (fraction)                        // never the case for step 255
+	{
+		temp += ((Temp_Table[step + 1] - temp) * fraction) >> 4;
+	}
+
+	Temp_Reading = temp >> 4;
+	Dial_Reading = Dial_Table[(dialCode + 8) >> 4];
+
+	// Transmit the set point and room temp to the A/C on a fixed period,
+	// independent of how often the display is redrawn
+	if (!transmitting)
+	{
+		transmitting = 1;
+		Timer_Start (0, 0, TX_PERIOD, Transmit_Callback);
+	}
+}
 
 //-----------------------------------------------------------------------------
 // TransmitData
 //-----------------------------------------------------------------------------
 //
 // Transmits a ZigBee Transmit Request frame with the "set" temp in payload 
-// byte 0 the actual room temp from the theromstat's temp sensor in byte 1
+// byte 0 the actual room temp from the theromstat's temp sensor in byte 1.
+// The control unit is reached by its 64-bit address alone.
 //
 //-----------------------------------------------------------------------------
 
 void TransmitData()
 {
-	short i = 0;
-	int sum = 0;
-
-	UART_Tx_Buffer[0] = 0x7E; // start byte
-	UART_Tx_Buffer[1] = 0x00; // Length MSB
-	UART_Tx_Buffer[2] = 0x10; // Length LSB
-	UART_Tx_Buffer[3] = 0x10; // frame type (0x10 = transmit request)
-	UART_Tx_Buffer[4] = 0x00; // frame ID, 0 means no ACK
-
-	UART_Tx_Buffer[5] = 0xFF;	// start 64-bit addr
-	UART_Tx_Buffer[6] = 0xFF;
-	UART_Tx_Buffer[7] = 0xFF;
-	UART_Tx_Buffer[8] = 0xFF;
-	UART_Tx_Buffer[9] = 0xFF;
-	UART_Tx_Buffer[10] = 0xFF;
-	UART_Tx_Buffer[11] = 0xFF;
-	UART_Tx_Buffer[12] = 0xFF;
-
-	UART_Tx_Buffer[13] = 0xFF;	// 16-bit net addr
-	UART_Tx_Buffer[14] = 0xFE;
-
-	UART_Tx_Buffer[15] = 0x00;
-	UART_Tx_Buffer[16] = 0x01; // set options flag
-
-	UART_Tx_Buffer[17] = Dial_Reading;
-	UART_Tx_Buffer[18] = Temp_Reading;
-
-	// compute the checksum per the ZigBee API spec
-	// Algorithm: Add all bytes except the first three, then remove
-	// all but the first 8 bits and subtract that value from 0xFF
-	for ( i = 3; i <= 18; i++ )
-	{
-		sum = sum + (int)UART_Tx_Buffer[i];
-	}
-
-	sum = sum & ~0xFF00;
-
-	sum = 0xFF - sum;
-
-	UART_Tx_Buffer[19] = sum;// checksum
-	UART_Tx_Buffer_Size = 19;
-
-	TX_Ready = 0;
-	SCON1 = (SCON1 | 0x02);
-}
-
-void GetDigits(float measurement, int * digit1, int * digit2)
-{
-	short firstDigit = 0;
-	short tens = 0;
-	short secondDigit = 0;
-
-	if (measurement < 0.0) measurement = 0.0f;
-	if (measurement >= 100.0) measurement = 99.0f;
-
-	firstDigit = (short)(measurement / 10.0f);
-	
-	if (firstDigit > 0.0f) 
-	{
-			*digit1 = firstDigit;
-	}
-	else 
-	{
-		*digit1 = 0;
-	}
-
-	tens = (short)firstDigit * 10;
-
-	secondDigit = (short)measurement - tens;
-	*digit2 = secondDigit;
-}
-
-
+	unsigned char payload[2];
 
+	payload[0] = Dial_Reading;
+	payload[1] = Temp_Reading;
 
+	XBee_Transmit(XBEE_ADDR16_UNKNOWN, payload, 2);
+}
 
 //-----------------------------------------------------------------------------
-// Wait
+// Transmit_Callback
 //-----------------------------------------------------------------------------
 //
-// Return Value : None
-// Parameters:
-//   1) unsigned int ms - number of milliseconds of delay
-//                        range is full range of integer: 0 to 65335
-//
-// This routine inserts a delay of <ms> milliseconds.
+// Periodic software timer callback that sends the latest readings to the
+// A/C unit. If both Tx slots are still busy the readings are simply sent on
+// the next period.
 //
 //-----------------------------------------------------------------------------
-void Wait(unsigned int ms, short us)
+
+void Transmit_Callback (void)
 {
+	TransmitData();
+}
 
-   CKCON &= ~0x20;                     // use SYSCLK/12 as timebase
-
-	if (us == 1)
-		RCAP2 = -(SYSCLK/1000000/12);          
-	else
-	   RCAP2 = -(SYSCLK/1000/12);          // Timer 2 overflows at 1 kHz
+//-----------------------------------------------------------------------------
+// SelfTest_Callback
+//-----------------------------------------------------------------------------
+//
+// Periodic software timer callback that flashes the status LEDs at start-up,
+// LED_SELF_TEST times, then stops its timer and hands the LEDs back to the
+// redraw.
+//
+//-----------------------------------------------------------------------------
 
-   TMR2 = RCAP2;
+void SelfTest_Callback (void)
+{
+	P5 ^= 0xF0;
 
-   ET2 = 0;                            // Disable Timer 2 interrupts
+	if (--selfTestLeft == 0)
+	{
+		Timer_Stop (1);
+	}
+}
 
-   TR2 = 1;                            // Start Timer 2
+// Splits a reading into its tens and units for the display, 99 at most
+void GetDigits(unsigned char value, unsigned char * digit1,
+			   unsigned char * digit2)
+{
+	if (value > 99) value = 99;
 
-   while(ms)
-   {
-      TF2 = 0;                         // Clear flag to initialize
-      while(!TF2);                     // Wait until timer overflows
-      ms--;                            // Decrement ms
-   }
+	*digit1 = value / 10;
+	*digit2 = value % 10;
+}
+
+
 
-   TR2 = 0;                            // Stop Timer 2
 
-}
 
 //-----------------------------------------------------------------------------
 // End Of File
@@ -0,0 +1,223 @@
+//-----------------------------------------------------------------------------
+// bench.c
+//-----------------------------------------------------------------------------
+//
+// Cycle counting and reporting for the ucsim benchmarks. See bench.h.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include <C8051F020_defs.h>
+#include "bench.h"
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+LOCATED_VARIABLE_NO_INIT (Bench_Sif, volatile unsigned char, SEG_XDATA, BENCH_SIF_ADDR);
+
+unsigned char SEG_DATA Bench_Overflows;      // Timer0 wraps in this count
+static unsigned long Bench_Overhead = 0;     // cycles of Begin/End alone
+
+static Bench_Stat SEG_XDATA Bench_Empty = { "empty" };
+
+//-----------------------------------------------------------------------------
+// Bench_Timer0_ISR
+//-----------------------------------------------------------------------------
+//
+// Counts Timer0 wraps. Written by hand so its cost is known exactly; see
+// BENCH_OVERFLOW_CYCLES.
+//
+//-----------------------------------------------------------------------------
+
+void Bench_Timer0_ISR (void) __interrupt (INTERRUPT_TIMER0) __naked
+{
+   __asm
+      inc   _Bench_Overflows
+      reti
+   __endasm;
+}
+
+//-----------------------------------------------------------------------------
+// Bench_Init
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Sets Timer0 up as a 16-bit machine cycle counter and measures the cost of
+// an empty BENCH, which every later result has taken off.
+//
+//-----------------------------------------------------------------------------
+
+void Bench_Init (void)
+{
+   unsigned char i;
+
+   EA = 0;
+   TMOD = (TMOD & 0xF0) | 0x01;        // Timer0 mode 1, counts SYSCLK/12
+   TR0 = 0;
+   TF0 = 0;
+   ET0 = 1;
+   EA = 1;
+
+   for (i = 0; i < 8; i++)
+   {
+      BENCH (Bench_Empty, ;);
+   }
+
+   Bench_Overhead = Bench_Empty.min;
+}
+
+//-----------------------------------------------------------------------------
+// Bench_Begin
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Starts counting. Timer0 is started by the last instruction before the
+// return, so apart from the return, which Bench_Init calibrates out, the
+// count covers only the caller's code.
+//
+//-----------------------------------------------------------------------------
+
+void Bench_Begin (void)
+{
+   TR0 = 0;
+   TL0 = 0;
+   TH0 = 0;
+   TF0 = 0;
+   Bench_Overflows = 0;
+   TR0 = 1;
+}
+
+//-----------------------------------------------------------------------------
+// Bench_End
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   :
+//   1) Bench_Stat *stat - where to add the measurement
+//
+// Stops counting and folds the cycles since Bench_Begin into <stat>.
+//
+//-----------------------------------------------------------------------------
+
+void Bench_End (Bench_Stat SEG_XDATA *stat)
+{
+   unsigned long cycles;
+
+   TR0 = 0;
+
+   cycles = ((unsigned long)Bench_Overflows << 16) |
+            ((unsigned int)TH0 << 8) | TL0;
+   cycles -= (unsigned long)Bench_Overflows * BENCH_OVERFLOW_CYCLES;
+   cycles -= Bench_Overhead;
+
+   if (stat->calls == 0 || cycles < stat->min)
+   {
+      stat->min = cycles;
+   }
+
+   if (cycles > stat->max)
+   {
+      stat->max = cycles;
+   }
+
+   stat->total += cycles;
+   stat->calls++;
+}
+
+//-----------------------------------------------------------------------------
+// Output
+//-----------------------------------------------------------------------------
+
+static void Bench_Putc (char c)
+{
+   Bench_Sif = 'p';
+   Bench_Sif = c;
+}
+
+static void Bench_Puts (const char SEG_CODE *s)
+{
+   while (*s)
+   {
+      Bench_Putc (*s++);
+   }
+}
+
+static void Bench_Putn (unsigned long n)
+{
+   char digits[10];
+   unsigned char i = 0;
+
+   do
+   {
+      digits[i++] = '0' + (n % 10);
+      n /= 10;
+   } while (n != 0);
+
+   Bench_Putc (' ');
+
+   while (i != 0)
+   {
+      Bench_Putc (digits[--i]);
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Bench_Report
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   :
+//   1) Bench_Stat *stat - measurement to print
+//
+// Prints "bench <name> <calls> <min> <max> <total>".
+//
+//-----------------------------------------------------------------------------
+
+void Bench_Report (Bench_Stat SEG_XDATA *stat)
+{
+   Bench_Puts ("bench ");
+   Bench_Puts (stat->name);
+   Bench_Putn (stat->calls);
+   Bench_Putn (stat->min);
+   Bench_Putn (stat->max);
+   Bench_Putn (stat->total);
+   Bench_Putc ('\n');
+}
+
+//-----------------------------------------------------------------------------
+// Bench_Done
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Reports the calibration, marks the end of the output and stops ucsim.
+//
+//-----------------------------------------------------------------------------
+
+void Bench_Done (void)
+{
+   EA = 0;
+
+   Bench_Puts ("bench-overhead");
+   Bench_Putn (Bench_Overhead);
+   Bench_Putc ('\n');
+   Bench_Puts ("bench-done\n");
+
+   Bench_Sif = 's';
+
+   while (1);
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,76 @@
+//-----------------------------------------------------------------------------
+// bench.h
+//-----------------------------------------------------------------------------
+//
+// Machine-cycle benchmarks for the firmware, built with SDCC and run under
+// the ucsim 8051 simulator (s51). See bench/ucsim_bench.py.
+//
+// Timer0 runs in 16-bit mode only while a measured call is in progress, so
+// it counts exactly the machine cycles the call takes. A naked overflow
+// interrupt extends it past 65535 cycles, and its own fixed cost is taken
+// back out. The cost of starting and stopping the count is measured once
+// in Bench_Init and subtracted from every result.
+//
+// Results are printed through ucsim's simulator interface, one line per
+// measurement:
+//
+//    bench <name> <calls> <min> <max> <total>
+//
+// The drivers (bench_ac.c, bench_th.c) link against the firmware sources
+// with main renamed to Firmware_Main and call the functions directly.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef BENCH_H
+#define BENCH_H
+
+//-----------------------------------------------------------------------------
+// Global Constants
+//-----------------------------------------------------------------------------
+
+// ucsim's simulator interface, as used by SDCC's own regression tests
+#define BENCH_SIF_ADDR       0xFFFF
+
+// Hardware LCALL and LJMP at the vector, INC direct and RETI
+#define BENCH_OVERFLOW_CYCLES 7
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+typedef struct
+{
+   const char SEG_CODE *name;
+   unsigned int calls;
+   unsigned long min;
+   unsigned long max;
+   unsigned long total;
+} Bench_Stat;
+
+// Measures one call of <expr> into the Bench_Stat <stat>
+#define BENCH(stat, expr) \
+   do { Bench_Begin(); expr; Bench_End(&(stat)); } while (0)
+
+// Calls a function declared as an interrupt handler as an ordinary one.
+// Its RETI returns like RET when no interrupt is in progress.
+typedef void (*Bench_Function) (void);
+#define BENCH_ISR(isr) (((Bench_Function)(isr))())
+
+//-----------------------------------------------------------------------------
+// Function Prototypes
+//-----------------------------------------------------------------------------
+
+void Bench_Init (void);
+void Bench_Begin (void);
+void Bench_End (Bench_Stat SEG_XDATA *stat);
+void Bench_Report (Bench_Stat SEG_XDATA *stat);
+void Bench_Done (void);
+
+// Must be visible in the module holding main for SDCC to place the vector
+void Bench_Timer0_ISR (void) __interrupt (INTERRUPT_TIMER0) __naked;
+
+#endif                                 // BENCH_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,164 @@
+//-----------------------------------------------------------------------------
+// bench_ac.c
+//-----------------------------------------------------------------------------
+//
+// Machine-cycle benchmarks for the A/C control unit. Linked with
+// control-unit.c and the common modules; see bench.h.
+//
+// The scripted frames are received one byte per UART1_Interrupt, and after
+// each frame one superloop pass runs the scheduler until no task is ready,
+// which parses the frame, updates the nodes and queues the reply. The other
+// functions are called on their own with their inputs set up beforehand.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include <C8051F020_defs.h>
+#include "bench.h"
+#include "bench_rx.h"
+#include "config.h"
+#include "uart.h"
+#include "filter.h"
+#include "nodes.h"
+#include "sched.h"
+
+//-----------------------------------------------------------------------------
+// Firmware symbols
+//-----------------------------------------------------------------------------
+
+unsigned char TransmitData (short avgTemp, char state);
+void GetInternalReadings (void);
+void Display_Temp (short measurement, short output);
+void Set_LEDs (void);
+
+extern Sched_Task SEG_XDATA Tasks[];
+extern Filter_MA SEG_XDATA AVG_Filter;
+extern volatile unsigned char DHT11_State;
+extern unsigned char dht11_dat[];
+extern signed int internal_temp;
+
+#define BENCH_TASKS     6              // TASK_COUNT in control-unit.c
+#define BENCH_DHT11_DONE 3             // DHT11_DONE in control-unit.c
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+Bench_Stat SEG_XDATA Bench_Uart_Rx = { "UART1_Interrupt.rx" };
+Bench_Stat SEG_XDATA Bench_Uart_Tx = { "UART1_Interrupt.tx" };
+Bench_Stat SEG_XDATA Bench_Transmit = { "TransmitData" };
+Bench_Stat SEG_XDATA Bench_Internal = { "GetInternalReadings" };
+Bench_Stat SEG_XDATA Bench_Display = { "Display_Temp" };
+Bench_Stat SEG_XDATA Bench_Leds = { "Set_LEDs" };
+Bench_Stat SEG_XDATA Bench_Superloop = { "superloop" };
+
+//-----------------------------------------------------------------------------
+// Support Subroutines
+//-----------------------------------------------------------------------------
+
+// Sends whatever is queued in the Tx slots, one transmit interrupt per byte
+static void Bench_Drain_Tx (void)
+{
+   while (!TX_Ready)
+   {
+      SCON1 |= 0x02;
+      BENCH (Bench_Uart_Tx, BENCH_ISR (UART1_Interrupt));
+   }
+}
+
+// One pass of the control unit's superloop with every task due
+static void Bench_Pass (void)
+{
+   unsigned char i;
+
+   for (i = 0; i < BENCH_TASKS; i++)
+   {
+      Sched_Pending[i] = 1;
+   }
+
+   BENCH (Bench_Superloop, while (Sched_Run ()));
+}
+
+//-----------------------------------------------------------------------------
+// main() Routine
+//-----------------------------------------------------------------------------
+
+void main (void)
+{
+   unsigned char i;
+   unsigned char t;
+
+   WDTCN = 0xDE;                       // Disable watchdog timer
+   WDTCN = 0xAD;
+
+   Node_Init ();
+   Filter_MA_Init (&AVG_Filter);
+   Sched_Init (Tasks, BENCH_TASKS);
+
+   Bench_Init ();
+
+   // Scripted frames in, one superloop pass after each
+   for (i = 0; i < sizeof(Bench_Rx_Control_Unit); i++)
+   {
+      SBUF1 = Bench_Rx_Control_Unit[i];
+      SCON1 |= 0x01;
+      BENCH (Bench_Uart_Rx, BENCH_ISR (UART1_Interrupt));
+
+      if (i + 1 == sizeof(Bench_Rx_Control_Unit) ||
+          Bench_Rx_Control_Unit[i + 1] == 0x7E)
+      {
+         Bench_Pass ();
+         Bench_Drain_Tx ();
+      }
+   }
+
+   // Replies to the thermostat
+   for (t = 0; t < 4; t++)
+   {
+      BENCH (Bench_Transmit, TransmitData (76, 0x01));
+      Bench_Drain_Tx ();
+   }
+
+   // A good DHT11 read of 15 C
+   for (t = 0; t < 4; t++)
+   {
+      dht11_dat[0] = 40;
+      dht11_dat[1] = 0;
+      dht11_dat[2] = 15;
+      dht11_dat[3] = 0;
+      dht11_dat[4] = 55;
+      DHT11_State = BENCH_DHT11_DONE;
+      BENCH (Bench_Internal, GetInternalReadings ());
+   }
+
+   for (t = 0; t < 100; t += 25)
+   {
+      BENCH (Bench_Display, Display_Temp (t, 0));
+      BENCH (Bench_Display, Display_Temp (t + 12, 1));
+   }
+
+   // All five coolant levels, 35 F to 75 F
+   for (t = 0; t < 5; t++)
+   {
+      internal_temp = 350 + t * 100;
+      BENCH (Bench_Leds, Set_LEDs ());
+   }
+
+   Bench_Report (&Bench_Uart_Rx);
+   Bench_Report (&Bench_Uart_Tx);
+   Bench_Report (&Bench_Transmit);
+   Bench_Report (&Bench_Internal);
+   Bench_Report (&Bench_Display);
+   Bench_Report (&Bench_Leds);
+   Bench_Report (&Bench_Superloop);
+
+   Bench_Done ();
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
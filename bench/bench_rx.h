@@ -0,0 +1,49 @@
+//-----------------------------------------------------------------------------
+// bench_rx.h
+//-----------------------------------------------------------------------------
+//
+// Scripted UART1 input for the benchmarks: complete ZigBee Rx Packet (0x90)
+// API frames as the XBee delivers them, checksums included. Each table is
+// a run of frames; the drivers feed them one byte per receive interrupt.
+//
+// Both images run the radio in API mode 2, so the 0x13 of the Digi OUI in
+// every source address arrives escaped, as 0x7D 0x33.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef BENCH_RX_H
+#define BENCH_RX_H
+
+// What the control unit hears: three remote sensors and the thermostat
+static const unsigned char SEG_CODE Bench_Rx_Control_Unit[] =
+{
+   // node A 0x1A2B, 78 F
+   0x7E, 0x00, 0x0D, 0x90, 0x00, 0x7D, 0x33, 0xA2, 0x00, 0x40, 0xA1, 0xB2, 0xC3,
+   0x1A, 0x2B, 0x01, 0x4E, 0xD0,
+
+   // node B 0x3C4D, 74 F
+   0x7E, 0x00, 0x0D, 0x90, 0x00, 0x7D, 0x33, 0xA2, 0x00, 0x40, 0xA1, 0xB2, 0xC4,
+   0x3C, 0x4D, 0x01, 0x4A, 0x8F,
+
+   // node C, 16-bit address unknown, 80 F
+   0x7E, 0x00, 0x0D, 0x90, 0x00, 0x7D, 0x33, 0xA2, 0x00, 0x40, 0xA1, 0xB2, 0xC5,
+   0xFF, 0xFE, 0x01, 0x50, 0x14,
+
+   // thermostat 0x8949, set 72 F, room 76 F
+   0x7E, 0x00, 0x0E, 0x90, 0x00, 0x7D, 0x33, 0xA2, 0x00, 0x40, 0xA1, 0xB2, 0xC6,
+   0x89, 0x49, 0x01, 0x48, 0x4C, 0xFA
+};
+
+// What the thermostat hears: the control unit's average and state
+static const unsigned char SEG_CODE Bench_Rx_Thermostat[] =
+{
+   // control unit, avg 74 F, unit on
+   0x7E, 0x00, 0x0E, 0x90, 0x00, 0x7D, 0x33, 0xA2, 0x00, 0x40, 0xA1, 0xB2, 0xA0,
+   0x00, 0x00, 0x01, 0x4A, 0x01, 0x3B
+};
+
+#endif                                 // BENCH_RX_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
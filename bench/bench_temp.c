@@ -0,0 +1,83 @@
+//-----------------------------------------------------------------------------
+// bench_temp.c
+//-----------------------------------------------------------------------------
+//
+// Machine-cycle benchmarks of the control unit's coolant temp path, for
+// tools/compare.py. Unlike bench_ac.c it only calls functions every
+// revision of control-unit.c has had, Display_Temp and Set_LEDs, so it
+// links against the original firmware as well as the current one; see
+// bench.h.
+//
+// Revisions from before the float removal keep the coolant temp as a float
+// in degrees and take one in Display_Temp. compare.py builds them with
+// BENCH_FLOAT defined.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include <C8051F020_defs.h>
+#include "bench.h"
+
+//-----------------------------------------------------------------------------
+// Firmware symbols
+//-----------------------------------------------------------------------------
+
+#ifdef BENCH_FLOAT
+void Display_Temp (float measurement, short output);
+extern float internal_temp;
+#define BENCH_DEGREES(d)  ((float)(d))
+#else
+void Display_Temp (short measurement, short output);
+extern signed int internal_temp;
+#define BENCH_DEGREES(d)  ((d) * 10)   // tenths of a degree F
+#endif
+
+void Set_LEDs ();
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+Bench_Stat SEG_XDATA Bench_Display = { "Display_Temp" };
+Bench_Stat SEG_XDATA Bench_Leds = { "Set_LEDs" };
+
+//-----------------------------------------------------------------------------
+// main() Routine
+//-----------------------------------------------------------------------------
+
+void main (void)
+{
+   unsigned char t;
+
+   WDTCN = 0xDE;                       // Disable watchdog timer
+   WDTCN = 0xAD;
+
+   Bench_Init ();
+
+   // The same values as bench_ac.c
+   for (t = 0; t < 100; t += 25)
+   {
+      BENCH (Bench_Display, Display_Temp (t, 0));
+      BENCH (Bench_Display, Display_Temp (t + 12, 1));
+   }
+
+   // All five coolant levels, 35 F to 75 F
+   for (t = 0; t < 5; t++)
+   {
+      internal_temp = BENCH_DEGREES (35 + t * 10);
+      BENCH (Bench_Leds, Set_LEDs ());
+   }
+
+   Bench_Report (&Bench_Display);
+   Bench_Report (&Bench_Leds);
+
+   Bench_Done ();
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,174 @@
+//-----------------------------------------------------------------------------
+// bench_th.c
+//-----------------------------------------------------------------------------
+//
+// Machine-cycle benchmarks for the thermostat. Linked with main.c and the
+// common modules; see bench.h.
+//
+// The control unit's frame is received one byte per UART1_Interrupt. The
+// superloop is measured both on a pass that only polls and on one that
+// queues an LCD redraw, Lcd_Timer4_ISR on sending that redraw, ADC1_ISR
+// on a block of samples from each ADC1 input, and GetAnalogReadings on
+// converting the result.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include <C8051F020_defs.h>
+#include "bench.h"
+#include "bench_rx.h"
+#include "config.h"
+#include "uart.h"
+#include "timer.h"
+
+//-----------------------------------------------------------------------------
+// Firmware symbols
+//-----------------------------------------------------------------------------
+
+INTERRUPT_PROTO (ADC1_ISR, INTERRUPT_ADC1_EOC);
+INTERRUPT_PROTO (Lcd_Timer4_ISR, INTERRUPT_TIMER4);
+void TransmitData (void);
+void Lcd8_Buf_Write_String (unsigned char row, unsigned char col, const char *a);
+unsigned char Lcd8_Flush (void);
+void Superloop (void);
+void GetAnalogReadings (void);
+
+extern unsigned int nextSample;
+extern volatile unsigned char Lcd_Queue_Done;
+extern volatile unsigned char Codes_Ready;
+
+#define BENCH_ADC_SAMPLES 512          // 2 * INT_DEC in main.c
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+Bench_Stat SEG_XDATA Bench_Uart_Rx = { "UART1_Interrupt.rx" };
+Bench_Stat SEG_XDATA Bench_Uart_Tx = { "UART1_Interrupt.tx" };
+Bench_Stat SEG_XDATA Bench_Transmit = { "TransmitData" };
+Bench_Stat SEG_XDATA Bench_Adc1 = { "ADC1_ISR" };
+Bench_Stat SEG_XDATA Bench_Readings = { "GetAnalogReadings" };
+Bench_Stat SEG_XDATA Bench_Timer4 = { "Lcd_Timer4_ISR" };
+Bench_Stat SEG_XDATA Bench_Lcd_String = { "Lcd8_Buf_Write_String+drain" };
+Bench_Stat SEG_XDATA Bench_Superloop = { "superloop" };
+Bench_Stat SEG_XDATA Bench_Superloop_Redraw = { "superloop.redraw" };
+
+//-----------------------------------------------------------------------------
+// Support Subroutines
+//-----------------------------------------------------------------------------
+
+// Draws a string into the frame buffer, queues the cells that changed and
+// sends them to the LCD, one transaction per Timer4 interrupt
+static void Bench_Lcd_Text (const char *a)
+{
+   Lcd8_Buf_Write_String (1, 1, a);
+   Lcd8_Flush ();
+
+   while (!Lcd_Queue_Done)
+   {
+      BENCH_ISR (Lcd_Timer4_ISR);
+   }
+}
+
+//-----------------------------------------------------------------------------
+// main() Routine
+//-----------------------------------------------------------------------------
+
+void main (void)
+{
+   unsigned char i;
+   unsigned char t;
+   unsigned int n;
+
+   WDTCN = 0xDE;                       // Disable watchdog timer
+   WDTCN = 0xAD;
+
+   // Timer2 running for the LCD driver's Tick_Spin, but without its
+   // interrupt, which would land in the middle of the measurements
+   Tick_Init ();
+   ET2 = 0;
+
+   Bench_Init ();
+
+   // Scripted frame in, then a pass that picks it up without redrawing
+   nextSample = Tick_Now () + 1000;
+
+   for (i = 0; i < sizeof(Bench_Rx_Thermostat); i++)
+   {
+      SBUF1 = Bench_Rx_Thermostat[i];
+      SCON1 |= 0x01;
+      BENCH (Bench_Uart_Rx, BENCH_ISR (UART1_Interrupt));
+   }
+
+   for (t = 0; t < 4; t++)
+   {
+      BENCH (Bench_Superloop, Superloop ());
+   }
+
+   // Passes with a redraw due
+   for (t = 0; t < 2; t++)
+   {
+      nextSample = Tick_Now ();
+      BENCH (Bench_Superloop_Redraw, Superloop ());
+   }
+
+   // The queued redraw out to the LCD, one transaction per interrupt; the
+   // last call finds the queue empty and stops Timer4
+   while (!Lcd_Queue_Done)
+   {
+      BENCH (Bench_Timer4, BENCH_ISR (Lcd_Timer4_ISR));
+   }
+
+   // Transmits to the control unit, one transmit interrupt per byte
+   for (t = 0; t < 2; t++)
+   {
+      BENCH (Bench_Transmit, TransmitData ());
+
+      while (!TX_Ready)
+      {
+         SCON1 |= 0x02;
+         BENCH (Bench_Uart_Tx, BENCH_ISR (UART1_Interrupt));
+      }
+   }
+
+   // A block of ADC1 samples of the TMP36, then one of the dial. Most
+   // calls only add the sample up (min), the last of each block decimates
+   // and switches inputs (max).
+   AMX1SL = 0x06;
+
+   for (n = 0; n < BENCH_ADC_SAMPLES; n++)
+   {
+      ADC1 = (AMX1SL == 0x06) ? 115 : 128;
+      BENCH (Bench_Adc1, BENCH_ISR (ADC1_ISR));
+   }
+
+   for (t = 0; t < 2; t++)
+   {
+      Codes_Ready = 1;
+      BENCH (Bench_Readings, GetAnalogReadings ());
+   }
+
+   // Four changed cells, as a caption swap would be, then back again
+   BENCH (Bench_Lcd_String, Bench_Lcd_Text ("Cool: "));
+   BENCH (Bench_Lcd_String, Bench_Lcd_Text ("Temp: "));
+
+   Bench_Report (&Bench_Uart_Rx);
+   Bench_Report (&Bench_Uart_Tx);
+   Bench_Report (&Bench_Transmit);
+   Bench_Report (&Bench_Adc1);
+   Bench_Report (&Bench_Readings);
+   Bench_Report (&Bench_Timer4);
+   Bench_Report (&Bench_Lcd_String);
+   Bench_Report (&Bench_Superloop);
+   Bench_Report (&Bench_Superloop_Redraw);
+
+   Bench_Done ();
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# ucsim_bench.py
+#-----------------------------------------------------------------------------
+#
+# Runs the benchmark images built by `make bench` under ucsim (s51), collects
+# the "bench <name> <calls> <min> <max> <total>" lines they print through the
+# simulator interface, and writes them all to one JSON file:
+#
+#    {
+#      "units": "machine cycles",
+#      "images": {
+#        "control-unit": {
+#          "TransmitData": {"calls": 4, "min": ..., "max": ..., "total": ...,
+#                           "mean": ...},
+#          ...
+#
+# With --baseline, each result is also compared against the same entry in an
+# earlier results file and the differences are printed.
+#
+# An image fails the run unless it prints its calibration, at least one
+# result and "bench-done". Anything else, such as a driver stuck waiting on
+# a peripheral ucsim's 8052 does not have, shows up as s51's own output.
+#
+# Usage: ucsim_bench.py [--s51 s51] [--baseline FILE] --out FILE
+#                       NAME=IMAGE.ihx [NAME=IMAGE.ihx ...]
+#
+#-----------------------------------------------------------------------------
+
+import argparse
+import json
+import re
+import subprocess
+import sys
+
+BENCH_LINE = re.compile(r"^bench (\S+) (\d+) (\d+) (\d+) (\d+)\s*$")
+OVERHEAD_LINE = re.compile(r"^bench-overhead (\d+)\s*$")
+DONE_LINE = "bench-done"
+
+TIMEOUT = 600                          # seconds of host time per image
+
+
+def run_image(s51, name, ihx):
+    """Runs one image to completion and returns its results."""
+    command = [s51, "-t", "8052", "-I", "if=xram[0xffff]", "-G", ihx]
+
+    try:
+        proc = subprocess.run(command, stdin=subprocess.DEVNULL,
+                              stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                              universal_newlines=True, timeout=TIMEOUT)
+    except FileNotFoundError:
+        sys.exit("ucsim_bench: %s not found; install ucsim (it ships with "
+                 "SDCC) or set S51=" % s51)
+    except subprocess.TimeoutExpired:
+        sys.exit("ucsim_bench: %s did not finish within %d s" % (name, TIMEOUT))
+
+    results = {}
+    overhead = None
+    done = False
+
+    for line in proc.stdout.splitlines():
+        match = BENCH_LINE.match(line)
+        if match:
+            calls, low, high, total = (int(x) for x in match.groups()[1:])
+            results[match.group(1)] = {
+                "calls": calls,
+                "min": low,
+                "max": high,
+                "total": total,
+                "mean": total // calls if calls else 0,
+            }
+            continue
+
+        match = OVERHEAD_LINE.match(line)
+        if match:
+            overhead = int(match.group(1))
+            continue
+
+        if line.strip() == DONE_LINE:
+            done = True
+
+    if not done or overhead is None or not results:
+        sys.stdout.write(proc.stdout)
+        sys.exit("ucsim_bench: %s stopped before reporting all results" % name)
+
+    print("%s (calibration %d cycles)" % (name, overhead))
+
+    return results
+
+
+def compare(images, baseline):
+    """Prints each result's change against the baseline's mean and max."""
+    for name, results in images.items():
+        old_results = baseline.get("images", {}).get(name, {})
+
+        for function, result in results.items():
+            old = old_results.get(function)
+            if old is None:
+                print("  %-32s new" % (name + ":" + function))
+                continue
+
+            delta = result["mean"] - old["mean"]
+            percent = 100.0 * delta / old["mean"] if old["mean"] else 0.0
+            print("  %-32s mean %8d -> %8d  %+8d (%+.1f%%)  max %d -> %d" %
+                  (name + ":" + function, old["mean"], result["mean"], delta,
+                   percent, old["max"], result["max"]))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--s51", default="s51")
+    parser.add_argument("--out", required=True)
+    parser.add_argument("--baseline")
+    parser.add_argument("images", nargs="+", metavar="NAME=IMAGE.ihx")
+    args = parser.parse_args()
+
+    images = {}
+
+    for image in args.images:
+        name, _, ihx = image.partition("=")
+        images[name] = run_image(args.s51, name, ihx)
+
+    for name, results in images.items():
+        for function, result in sorted(results.items()):
+            print("  %-32s calls %5d  min %8d  max %8d  mean %8d" %
+                  (name + ":" + function, result["calls"], result["min"],
+                   result["max"], result["mean"]))
+
+    with open(args.out, "w") as out:
+        json.dump({"units": "machine cycles", "images": images}, out,
+                  indent=2, sort_keys=True)
+        out.write("\n")
+
+    print("wrote %s" % args.out)
+
+    if args.baseline:
+        try:
+            with open(args.baseline) as f:
+                baseline = json.load(f)
+        except FileNotFoundError:
+            print("no baseline at %s; run `make bench-baseline` to save one" %
+                  args.baseline)
+            return 0
+
+        print("against %s:" % args.baseline)
+        compare(images, baseline)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,235 @@
+//-----------------------------------------------------------------------------
+// clock.c
+//-----------------------------------------------------------------------------
+//
+// Switches SYSCLK from the 2 MHz internal oscillator the part resets to over
+// to the external crystal, and between full and half speed on it. See
+// clock.h.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include <C8051F020_defs.h>            // SFR declarations
+#include "config.h"                    // Per-image settings
+#include "clock.h"
+#include "uart.h"
+#include "timer.h"
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+unsigned char Clock_Shift = CLOCK_FULL;
+
+static unsigned char Clock_Holds = 0;  // Clock_Hold calls not yet released
+
+//-----------------------------------------------------------------------------
+// OSCILLATOR_Start
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Starts the external 22.1184 MHz crystal and returns without waiting for
+// it. Meanwhile the internal oscillator is sped up from the 2 MHz it resets
+// to to 16 MHz, so the start-up code that runs before OSCILLATOR_Init gets
+// through it eight times as fast.
+//
+//-----------------------------------------------------------------------------
+void OSCILLATOR_Start (void)
+{
+   OSCXCN = 0x67;                      // Crystal oscillator mode, f > 6.7 MHz
+
+   OSCICN = 0x07;                      // IOSCEN, IFCN = 11: 16 MHz
+   while (!(OSCICN & 0x10));           // Wait for IFRDY
+}
+
+//-----------------------------------------------------------------------------
+// OSCILLATOR_Init
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Waits for the crystal OSCILLATOR_Start started to settle and then selects
+// it as SYSCLK. The same OSCICN write turns on the missing clock detector
+// and stops the internal oscillator, so the switch is a single store and
+// the part never runs with the detector armed on a clock that is about to
+// go away.
+//
+//-----------------------------------------------------------------------------
+void OSCILLATOR_Init (void)
+{
+   int i;                              // Software timer
+
+   // XTLVLD reads as garbage for the first 1 ms after the crystal is
+   // started. A pass of this 16-bit loop takes over 8 cycles, so 2560 of
+   // them cover it even with the 16 MHz internal oscillator 20% fast,
+   // without counting the start-up code run since OSCILLATOR_Start.
+   for (i = 0; i < 2560; i++);
+
+   while (!(OSCXCN & 0x80));           // Wait for XTLVLD
+
+   OSCICN = 0x88;                      // MSCLKE | CLKSL: missing clock
+                                       // detector on, SYSCLK from the crystal,
+                                       // IOSCEN = 0 stops the internal osc.
+}
+
+//-----------------------------------------------------------------------------
+// Clock_Scale
+//-----------------------------------------------------------------------------
+//
+// Return Value : <left> counts scaled to the clock being switched to
+// Parameters   :
+//   1) unsigned int left - counts a timer has to go before it overflows, 1
+//                          to a whole period
+//   2) unsigned char shift - CLOCK_FULL or CLOCK_HALF, the new clock
+//
+// Halving rounds up, so a timer one count from overflowing is left one
+// count from it rather than none, which would be a whole 65536 counts.
+//
+//-----------------------------------------------------------------------------
+static unsigned int Clock_Scale (unsigned int left, unsigned char shift)
+{
+   return shift ? (left + 1) >> 1 : left << 1;
+}
+
+//-----------------------------------------------------------------------------
+// Clock_Set
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   :
+//   1) unsigned char shift - CLOCK_FULL or CLOCK_HALF
+//
+// Switches the crystal's divide-by-2 stage in or out and reloads Timer1,
+// Timer2 and, if the image uses them, Timer3 and Timer4 for the new SYSCLK.
+// Their reloads are worked out from the full-speed counts every time rather
+// than from the current ones, so switching back and forth never drifts.
+//
+// The switch is done with interrupts off and the timers stopped, and the
+// count each one is part-way through is scaled along with its reload.
+// XOSCMD is only changed with SYSCLK on the internal oscillator: the
+// crystal's output is not guaranteed clean across a mode write, and with it
+// as SYSCLK a glitch would reach the CPU and, with the missing clock
+// detector armed, could reset the part. The internal oscillator runs just
+// for the switch and XTLVLD is checked before going back to the crystal.
+// Timer1's overflow rate is UART1's baud rate times 16, so a byte in flight
+// sees at most a few SYSCLKs of one overflow go missing, far inside the
+// receiver's tolerance. The other timers likewise lose only the few cycles
+// they are stopped for.
+//
+//-----------------------------------------------------------------------------
+void Clock_Set (unsigned char shift)
+{
+   unsigned char ea;
+   unsigned int left;
+#ifdef CLOCK_TIMER3_COUNTS
+   unsigned char tr3;
+#endif
+#ifdef CLOCK_TIMER4_COUNTS
+   unsigned char tr4;
+#endif
+
+   if (shift == Clock_Shift)
+   {
+      return;
+   }
+
+   ea = EA;
+   EA = 0;
+
+   TR1 = 0;
+   TR2 = 0;
+#ifdef CLOCK_TIMER3_COUNTS
+   tr3 = TMR3CN & 0x04;                // TR3, may be off
+   TMR3CN &= ~0x04;
+#endif
+#ifdef CLOCK_TIMER4_COUNTS
+   tr4 = T4CON & 0x04;                 // TR4, may be off
+   T4CON &= ~0x04;
+#endif
+
+   OSCICN = 0x8F;                      // IOSCEN, 16 MHz, still on crystal
+   while (!(OSCICN & 0x10));           // Wait for IFRDY
+   OSCICN = 0x87;                      // SYSCLK from the internal osc.
+
+   OSCXCN = shift ? 0x77 : 0x67;       // crystal mode, with or without /2
+   while (!(OSCXCN & 0x80));           // Wait for XTLVLD
+
+   OSCICN = 0x88;                      // Back to the crystal, internal off
+   Clock_Shift = shift;
+
+   // Counts still to go before each timer overflows, scaled to the new clock
+   left = 256 - TL1;
+   TH1 = 256 - (UART_TH1_COUNTS >> shift);
+   TL1 = 256 - Clock_Scale (left, shift);
+
+   left = 65536L - TMR2;
+   RCAP2 = -(TICK_PERIOD >> shift);
+   TMR2 = -Clock_Scale (left, shift);
+
+#ifdef CLOCK_TIMER3_COUNTS
+   left = 65536L - TMR3;
+   TMR3RL = -(CLOCK_TIMER3_COUNTS >> shift);
+   TMR3 = -Clock_Scale (left, shift);
+   TMR3CN |= tr3;
+#endif
+
+#ifdef CLOCK_TIMER4_COUNTS
+   left = 65536L - TMR4;
+   TMR4RL = -(CLOCK_TIMER4_COUNTS >> shift);
+   TMR4 = -Clock_Scale (left, shift);
+   T4CON |= tr4;
+#endif
+
+   TR2 = 1;
+   TR1 = 1;
+
+   EA = ea;
+}
+
+//-----------------------------------------------------------------------------
+// Clock_Hold
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Runs at full speed until every hold taken has been released. Holds nest,
+// so a burst of work can take one inside another, for instance a frame
+// parsed while a DHT11 read is under way.
+//
+//-----------------------------------------------------------------------------
+void Clock_Hold (void)
+{
+   Clock_Holds++;
+   Clock_Set (CLOCK_FULL);
+}
+
+//-----------------------------------------------------------------------------
+// Clock_Release
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Gives up a hold taken with Clock_Hold, dropping to half speed with the
+// last one.
+//
+//-----------------------------------------------------------------------------
+void Clock_Release (void)
+{
+   if (--Clock_Holds == 0)
+   {
+      Clock_Set (CLOCK_HALF);
+   }
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
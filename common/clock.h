@@ -0,0 +1,78 @@
+//-----------------------------------------------------------------------------
+// clock.h
+//-----------------------------------------------------------------------------
+//
+// System clock set-up, shared by the A/C control unit and the thermostat.
+// Both boards run from a 22.1184 MHz crystal, which divides down to the
+// standard baud rates exactly.
+//
+// The part resets to its internal oscillator. OSCILLATOR_Start, first thing
+// in main, starts the crystal and runs the internal oscillator at its
+// fastest while the crystal settles; start-up code that does not depend on
+// SYSCLK, such as PORT_Init, can run in the meantime. OSCILLATOR_Init then
+// waits for the crystal and switches to it, and must come before anything
+// that times itself off SYSCLK: UART1_Init, Tick_Init and the like.
+//
+// Once started, the crystal can also be run through the oscillator's
+// divide-by-2 stage. Halving SYSCLK roughly halves what the core and the
+// peripherals draw, and the half-speed clock still divides down to the
+// same baud rates exactly, which the 20% internal oscillator would not.
+//
+//    Clock_Set(s)      switch SYSCLK to SYSCLK >> s, CLOCK_FULL or
+//                      CLOCK_HALF, and reload every timer that runs off it
+//                      so the UART, the tick, Timer3 and Timer4 keep their
+//                      rates
+//    Clock_Hold()      run at full speed until the matching Clock_Release,
+//                      for bursts of work or for timing done in SYSCLK
+//                      counts, such as a DHT11 read on the PCA
+//    Clock_Release()   drop back to CLOCK_HALF once the last hold is gone
+//
+// All three must be called from main, never from an ISR; code that times
+// itself off Timer2 relies on the clock not changing under it. They also
+// restart Timer1 and Timer2, so UART1_Init and Tick_Init must have run.
+//
+// An image whose Timer3 or Timer4 runs off SYSCLK defines, in its config.h:
+//
+//    CLOCK_TIMER3_COUNTS  Timer3 counts per overflow at full speed
+//    CLOCK_TIMER4_COUNTS  Timer4 counts per overflow at full speed
+//
+// Timer3 is restarted on every switch. Timer4 is left running or stopped,
+// as it was, since the thermostat only runs it while the LCD has work.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+//-----------------------------------------------------------------------------
+// Global Constants
+//-----------------------------------------------------------------------------
+
+#ifndef SYSCLK
+#define SYSCLK       22118400L         // External crystal oscillator frequency
+#endif
+
+#define CLOCK_FULL   0                 // SYSCLK, the crystal as it is
+#define CLOCK_HALF   1                 // SYSCLK/2, through the divide-by-2
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+extern unsigned char Clock_Shift;      // running at SYSCLK >> Clock_Shift
+
+//-----------------------------------------------------------------------------
+// Function Prototypes
+//-----------------------------------------------------------------------------
+
+void OSCILLATOR_Start (void);
+void OSCILLATOR_Init (void);
+void Clock_Set (unsigned char shift);
+void Clock_Hold (void);
+void Clock_Release (void);
+
+#endif                                 // CLOCK_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,71 @@
+//-----------------------------------------------------------------------------
+// filter.c
+//-----------------------------------------------------------------------------
+//
+// Moving-average filter. See filter.h for the overview.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include "filter.h"
+
+//-----------------------------------------------------------------------------
+// Filter_MA_Init
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   :
+//   1) Filter_MA *f - filter to reset
+//
+// Empties the filter. The next sample fills the whole window.
+//
+//-----------------------------------------------------------------------------
+void Filter_MA_Init (Filter_MA *f)
+{
+   f->primed = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Filter_MA_Add
+//-----------------------------------------------------------------------------
+//
+// Return Value : average of the last FILTER_WINDOW samples
+// Parameters   :
+//   1) Filter_MA *f - filter to update
+//   2) unsigned char sample - new sample
+//
+// The first sample after Filter_MA_Init is copied into every slot, so the
+// output starts at the first reading instead of ramping up from zero.
+//
+//-----------------------------------------------------------------------------
+unsigned char Filter_MA_Add (Filter_MA *f, unsigned char sample)
+{
+   unsigned char i;
+
+   if (!f->primed)
+   {
+      for (i = 0; i < FILTER_WINDOW; i++)
+      {
+         f->history[i] = sample;
+      }
+
+      f->sum = (signed int)sample << FILTER_SHIFT;
+      f->index = 0;
+      f->primed = 1;
+
+      return sample;
+   }
+
+   f->sum += sample - f->history[f->index];
+   f->history[f->index] = sample;
+   f->index = (f->index + 1) & (FILTER_WINDOW - 1);
+
+   return f->sum >> FILTER_SHIFT;
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
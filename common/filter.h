@@ -0,0 +1,56 @@
+//-----------------------------------------------------------------------------
+// filter.h
+//-----------------------------------------------------------------------------
+//
+// Integer smoothing filter for sensor readings.
+//
+// Filter_MA is a moving average of 8-bit samples over the last FILTER_WINDOW
+// of them. It keeps a running sum, so each new sample costs one add, one
+// subtract and a shift however long the window is, all in 16 bits. The
+// window is a power of two set at compile time through FILTER_SHIFT (pass
+// -DFILTER_SHIFT=n to change it for the whole image), up to 128 samples so
+// the sum cannot overflow. Its state is the sample history plus the sum.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef FILTER_H
+#define FILTER_H
+
+//-----------------------------------------------------------------------------
+// Global Constants
+//-----------------------------------------------------------------------------
+
+#ifndef FILTER_SHIFT
+#define FILTER_SHIFT     3             // moving average over 8 samples
+#endif
+
+#define FILTER_WINDOW    (1 << FILTER_SHIFT)
+
+#if (255L << FILTER_SHIFT) > 32767
+#error "FILTER_SHIFT too large: the sum of a window of samples overflows"
+#endif
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+typedef struct
+{
+   unsigned char history[FILTER_WINDOW];  // last FILTER_WINDOW samples
+   signed int sum;                     // sum of history
+   unsigned char index;                // oldest sample, replaced next
+   unsigned char primed;               // 0 until the first sample
+} Filter_MA;
+
+//-----------------------------------------------------------------------------
+// Function Prototypes
+//-----------------------------------------------------------------------------
+
+void Filter_MA_Init (Filter_MA *f);
+unsigned char Filter_MA_Add (Filter_MA *f, unsigned char sample);
+
+#endif                                 // FILTER_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
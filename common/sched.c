@@ -0,0 +1,137 @@
+//-----------------------------------------------------------------------------
+// sched.c
+//-----------------------------------------------------------------------------
+//
+// Cooperative task scheduler. See sched.h for how tasks are described.
+//
+// Runtimes are measured on the 1 ms system tick, so a task that finishes
+// inside one tick shows a runtime of 0 or 1 ms. That is fine for finding the
+// task that blows a loop budget measured in milliseconds.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include <C8051F020_defs.h>            // SFR declarations
+#include "timer.h"
+#include "sched.h"
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+volatile unsigned char Sched_Pending[SCHED_MAX_TASKS];
+
+static Sched_Task *Sched_Tasks;
+static unsigned char Sched_Count = 0;
+
+//-----------------------------------------------------------------------------
+// Sched_Init
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   :
+//   1) Sched_Task *tasks - task table owned by the application
+//   2) unsigned char count - number of tasks, at most SCHED_MAX_TASKS
+//
+// Clears the statistics and schedules each periodic task's first run
+// <phase> ms from now. Call after Tick_Init.
+//
+//-----------------------------------------------------------------------------
+void Sched_Init (Sched_Task *tasks, unsigned char count)
+{
+   unsigned char i;
+   unsigned int now = Tick_Now();
+
+   Sched_Tasks = tasks;
+   Sched_Count = count;
+
+   for (i = 0; i < count; i++)
+   {
+      tasks[i].next_run = now + tasks[i].phase;
+      tasks[i].last_run = now;
+      tasks[i].worst = 0;
+      tasks[i].overruns = 0;
+      Sched_Pending[i] = 0;
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Sched_Run
+//-----------------------------------------------------------------------------
+//
+// Return Value : 1 if a task ran, 0 if nothing was ready
+// Parameters   : None
+//
+// Runs the most urgent ready task once. Call from the superloop on every
+// pass. Because only one task runs per call, an event that arrives while a
+// slow periodic task is running is picked up straight after it.
+//
+//-----------------------------------------------------------------------------
+unsigned char Sched_Run (void)
+{
+   unsigned char i;
+   unsigned char best = 0xFF;
+   unsigned int now = Tick_Now();
+   unsigned int runtime;
+   Sched_Task *task;
+
+   for (i = 0; i < Sched_Count; i++)
+   {
+      task = &Sched_Tasks[i];
+
+      if (Sched_Pending[i] ||
+          (task->period != 0 && (signed int)(now - task->next_run) >= 0))
+      {
+         if (best == 0xFF || task->priority < Sched_Tasks[best].priority)
+         {
+            best = i;
+         }
+      }
+   }
+
+   if (best == 0xFF)
+   {
+      return 0;
+   }
+
+   task = &Sched_Tasks[best];
+
+   // Clear the event before running so one that arrives mid-run is kept
+   Sched_Pending[best] = 0;
+
+   if (task->period != 0 && (signed int)(now - task->next_run) >= 0)
+   {
+      task->next_run += task->period;
+
+      // Fell more than a whole period behind; skip the missed runs rather
+      // than firing them back to back
+      if ((signed int)(now - task->next_run) >= 0)
+      {
+         task->next_run = now + task->period;
+      }
+   }
+
+   task->last_run = now;
+   task->run();
+   runtime = Tick_Now() - now;
+
+   if (runtime > task->worst)
+   {
+      task->worst = runtime;
+   }
+
+   if (runtime > task->budget && task->overruns != 0xFF)
+   {
+      task->overruns++;
+   }
+
+   return 1;
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+//-----------------------------------------------------------------------------
+// sched.h
+//-----------------------------------------------------------------------------
+//
+// Cooperative run-to-completion task scheduler built on the system tick in
+// timer.h.
+//
+// The application owns a table of Sched_Task descriptors and calls
+// Sched_Run from its superloop. Each call runs at most one task: the
+// highest-priority task (lowest number) that is either signalled or has
+// reached its next periodic deadline. Tasks always run to completion, so a
+// task that takes too long delays everything behind it; the per-task
+// worst-case runtime and overrun count make that visible.
+//
+// Event-driven tasks use a period of 0 and are only run once signalled with
+// Sched_Signal, which is a single byte store and safe to use from an ISR.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef SCHED_H
+#define SCHED_H
+
+//-----------------------------------------------------------------------------
+// Global Constants
+//-----------------------------------------------------------------------------
+
+#ifndef SCHED_MAX_TASKS
+#define SCHED_MAX_TASKS 8
+#endif
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+typedef void (*Sched_Function) (void);
+
+typedef struct
+{
+   // Set up by the application
+   Sched_Function run;
+   unsigned int period;                // ms between runs, 0 = event only
+   unsigned int phase;                 // ms after Sched_Init of first run
+   unsigned char priority;             // 0 is the most urgent
+   unsigned int budget;                // ms a single run may take
+
+   // Kept by the scheduler
+   unsigned int next_run;              // tick of the next periodic run
+   unsigned int last_run;              // tick the last run started
+   unsigned int worst;                 // longest run seen, in ms
+   unsigned char overruns;             // runs that went over budget
+} Sched_Task;
+
+extern volatile unsigned char Sched_Pending[SCHED_MAX_TASKS];
+
+#define Sched_Signal(id) (Sched_Pending[(id)] = 1)
+
+//-----------------------------------------------------------------------------
+// Function Prototypes
+//-----------------------------------------------------------------------------
+
+void Sched_Init (Sched_Task *tasks, unsigned char count);
+unsigned char Sched_Run (void);
+
+#endif                                 // SCHED_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,373 @@
+//-----------------------------------------------------------------------------
+// timer.c
+//-----------------------------------------------------------------------------
+//
+// Interrupt-driven 1 ms system tick on Timer2 and a small table of software
+// timers driven from it. See timer.h for the API.
+//
+// The old Wait/Wait_MS routines reprogrammed Timer2 on every call and spun on
+// TF2, so the CPU could do nothing else while waiting. Here Timer2 is set up
+// once and the superloop checks deadlines instead of sleeping.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include <C8051F020_defs.h>            // SFR declarations
+#include "clock.h"
+#include "timer.h"
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+volatile unsigned int Tick_Count = 0;
+
+unsigned char Idle_Percent = 0;
+unsigned int Idle_Wakeups = 0;
+
+unsigned int Ready_Ms = 0xFFFF;
+
+static unsigned long Idle_Counts;      // Timer2 counts idle this window
+static unsigned int Idle_Wakes;        // Tick_Idle calls this window
+static unsigned int Idle_Window_End;   // tick the window closes
+
+typedef struct
+{
+   unsigned int deadline;              // tick at which the callback is due
+   unsigned int period;                // 0 for a one-shot timer
+   Timer_Callback callback;            // 0 while the timer is stopped
+} Timer_Entry;
+
+static Timer_Entry Timers[TIMER_COUNT];
+
+//-----------------------------------------------------------------------------
+// Tick_Init
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Configures Timer2 to auto-reload at TICK_HZ from SYSCLK/12 and enables its
+// interrupt. Tick_Count starts counting once EA is set.
+//
+//-----------------------------------------------------------------------------
+void Tick_Init (void)
+{
+   unsigned char i;
+
+   for (i = 0; i < TIMER_COUNT; i++)
+   {
+      Timers[i].callback = 0;
+   }
+
+   T2CON = 0x00;                       // Stop Timer2, 16-bit auto-reload
+   CKCON &= ~0x20;                     // use SYSCLK/12 as timebase
+
+   RCAP2 = -(TICK_PERIOD >> Clock_Shift);   // Timer 2 overflows at 1 kHz
+   TMR2 = RCAP2;
+
+   Idle_Counts = 0;
+   Idle_Wakes = 0;
+   Idle_Window_End = Tick_Count + TICK_HZ;
+
+   ET2 = 1;                            // Enable Timer 2 interrupts
+   TR2 = 1;                            // Start Timer 2
+}
+
+//-----------------------------------------------------------------------------
+// Tick_Now
+//-----------------------------------------------------------------------------
+//
+// Return Value : current tick in ms
+// Parameters   : None
+//
+// Tick_Count is two bytes, so the tick interrupt is held off for the two
+// MOVs it takes to copy it. Must not be called from an ISR.
+//
+//-----------------------------------------------------------------------------
+unsigned int Tick_Now (void)
+{
+   unsigned int now;
+
+   ET2 = 0;
+   now = Tick_Count;
+   ET2 = 1;
+
+   return now;
+}
+
+//-----------------------------------------------------------------------------
+// Tick_Expired
+//-----------------------------------------------------------------------------
+//
+// Return Value : 1 if <deadline> has been reached, otherwise 0
+// Parameters   :
+//   1) unsigned int deadline - tick to compare against
+//
+// The subtraction is done modulo 2^16 and read as signed, so this keeps
+// working across the tick wrapping around as long as deadlines are set less
+// than 32.767 s ahead.
+//
+//-----------------------------------------------------------------------------
+unsigned char Tick_Expired (unsigned int deadline)
+{
+   return (signed int)(Tick_Now() - deadline) >= 0;
+}
+
+//-----------------------------------------------------------------------------
+// Tick_Delay
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   :
+//   1) unsigned int ms - number of milliseconds of delay
+//
+// Blocking delay on the tick, for start-up and hardware handshakes that need
+// one. Interrupts keep being serviced while it waits, and the CPU idles
+// between them.
+//
+//-----------------------------------------------------------------------------
+void Tick_Delay (unsigned int ms)
+{
+   unsigned int deadline = Tick_Now() + ms;
+
+   while (!Tick_Expired(deadline))
+   {
+      Tick_Idle();
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Timer2_Count
+//-----------------------------------------------------------------------------
+//
+// Return Value : Timer2's running count
+// Parameters   : None
+//
+// The high byte is read on both sides of the low one, so a carry between
+// the two reads is never mistaken for a jump of 256 counts.
+//
+//-----------------------------------------------------------------------------
+static unsigned int Timer2_Count (void)
+{
+   unsigned char high;
+   unsigned char low;
+
+   do
+   {
+      high = TH2;
+      low = TL2;
+   } while (high != TH2);
+
+   return ((unsigned int)high << 8) | low;
+}
+
+//-----------------------------------------------------------------------------
+// Tick_Idle
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Puts the CPU in IDLE mode until the next interrupt, and adds the time it
+// spent there to Idle_Percent's count. Call from the superloop once a pass
+// has found nothing to do. An interrupt that posts work just before IDLE is
+// set is only acted on after the next one, at most a tick later.
+//
+// The time is read off Timer2's running count on either side. The tick
+// interrupt ends IDLE too, so the timer has reloaded at most once in
+// between, and checking the window only then keeps the common wake-up
+// short. The time includes the ISR that woke the CPU. It is kept in
+// full-speed counts, whatever the clock was at the time.
+//
+//-----------------------------------------------------------------------------
+void Tick_Idle (void)
+{
+   unsigned int start = Timer2_Count();
+   unsigned int end;
+
+   PCON |= 0x01;                       // IDLE; the next interrupt ends it
+
+   end = Timer2_Count();
+   Idle_Wakes++;
+
+   if (end >= start)
+   {
+      Idle_Counts += (unsigned long)(end - start) << Clock_Shift;
+      return;
+   }
+
+   end += TICK_PERIOD >> Clock_Shift;
+   Idle_Counts += (unsigned long)(end - start) << Clock_Shift;
+
+   if (Tick_Expired(Idle_Window_End))
+   {
+      Idle_Percent = Idle_Counts / (TICK_PERIOD * (TICK_HZ / 100L));
+      Idle_Wakeups = Idle_Wakes;
+      Idle_Counts = 0;
+      Idle_Wakes = 0;
+      Idle_Window_End += TICK_HZ;
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Tick_Ready
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Marks the end of start-up by keeping the current tick in Ready_Ms. Call
+// once, just before the superloop. The tick starts counting when EA is set,
+// so Ready_Ms leaves out the few ms before that, which are mostly the
+// crystal settling in OSCILLATOR_Init.
+//
+//-----------------------------------------------------------------------------
+void Tick_Ready (void)
+{
+   Ready_Ms = Tick_Now();
+}
+
+//-----------------------------------------------------------------------------
+// Tick_Spin
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   :
+//   1) unsigned int counts - full-speed Timer2 counts to wait, see
+//                            TICK_COUNTS
+//
+// Busy-waits on Timer2's running count rather than on Tick_Count, so the
+// delay is accurate to a count (0.54 us at 22.1184 MHz, 1.09 us at half
+// speed) and does not need the tick interrupt. The count is sampled often
+// enough that it never goes round a whole period unseen, so each step
+// between samples is the difference of the two, plus one period when the
+// timer has reloaded in between. Counts up to 65535 (35 ms) can be waited.
+//
+//-----------------------------------------------------------------------------
+void Tick_Spin (unsigned int counts)
+{
+   unsigned int last;
+   unsigned int now;
+   unsigned int step;
+
+   counts >>= Clock_Shift;
+   last = Timer2_Count();
+
+   while (1)
+   {
+      now = Timer2_Count();
+
+      step = now - last;
+      if (now < last)
+      {
+         step += TICK_PERIOD >> Clock_Shift;   // reloaded in between
+      }
+
+      if (step >= counts)
+      {
+         return;
+      }
+
+      counts -= step;
+      last = now;
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Timer_Start
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   :
+//   1) unsigned char id - software timer slot, 0 to TIMER_COUNT-1
+//   2) unsigned int delay - ms until the first call
+//   3) unsigned int period - ms between later calls, 0 for a one-shot
+//   4) Timer_Callback callback - function run from Timer_Service
+//
+// (Re)arms a software timer. Periodic timers are rescheduled from their
+// previous deadline rather than from when they ran, so they do not drift.
+//
+//-----------------------------------------------------------------------------
+void Timer_Start (unsigned char id, unsigned int delay, unsigned int period,
+                  Timer_Callback callback)
+{
+   Timers[id].deadline = Tick_Now() + delay;
+   Timers[id].period = period;
+   Timers[id].callback = callback;
+}
+
+//-----------------------------------------------------------------------------
+// Timer_Stop
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   :
+//   1) unsigned char id - software timer slot, 0 to TIMER_COUNT-1
+//
+//-----------------------------------------------------------------------------
+void Timer_Stop (unsigned char id)
+{
+   Timers[id].callback = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Timer_Service
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Runs the callback of every timer whose deadline has passed. Call this from
+// the superloop on every pass.
+//
+//-----------------------------------------------------------------------------
+void Timer_Service (void)
+{
+   unsigned char i;
+   Timer_Callback callback;
+
+   for (i = 0; i < TIMER_COUNT; i++)
+   {
+      callback = Timers[i].callback;
+
+      if (callback != 0 && Tick_Expired(Timers[i].deadline))
+      {
+         if (Timers[i].period != 0)
+         {
+            Timers[i].deadline += Timers[i].period;
+         }
+         else
+         {
+            Timers[i].callback = 0;
+         }
+
+         callback();
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Interrupt Service Routines
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Timer2_ISR
+//-----------------------------------------------------------------------------
+//
+// Counts milliseconds. TF2 is not cleared by hardware on the 'F02x.
+//
+//-----------------------------------------------------------------------------
+INTERRUPT (Timer2_ISR, INTERRUPT_TIMER2)
+{
+   TF2 = 0;
+   Tick_Count++;
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
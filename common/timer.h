@@ -0,0 +1,87 @@
+//-----------------------------------------------------------------------------
+// timer.h
+//-----------------------------------------------------------------------------
+//
+// System tick and software timers, shared by the A/C control unit and the
+// thermostat.
+//
+// Timer2 runs in 16-bit auto-reload mode and interrupts once per millisecond.
+// Its ISR only bumps Tick_Count; everything else runs from the superloop:
+//
+//    Tick_Now()        current tick in ms (wraps every 65.536 s)
+//    Tick_Expired(t)   1 once tick <t> has been reached, wrap-safe for
+//                      deadlines up to 32.767 s away
+//    Timer_Start()     arm a one-shot (period 0) or periodic callback
+//    Timer_Service()   call from the superloop to run due callbacks
+//    Tick_Spin(n)      busy-wait n counts of Timer2 at full speed
+//                      (SYSCLK/12), for sub-millisecond hardware timing;
+//                      works before EA is set, unlike Tick_Delay
+//    Tick_Idle()       idle the CPU until the next interrupt; the share of
+//                      each second spent there is kept in Idle_Percent, and
+//                      how often it woke in Idle_Wakeups
+//    Tick_Ready()      mark the end of start-up, just before the superloop;
+//                      the tick it was reached on is kept in Ready_Ms
+//
+// Timer2 belongs to this module from Tick_Init on, so firmware must not
+// reprogram it for delays.
+//
+// Include after compiler_defs.h so INTERRUPT_PROTO is defined; SDCC needs the
+// ISR prototype visible in the file that contains main.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef TIMER_H
+#define TIMER_H
+
+//-----------------------------------------------------------------------------
+// Global Constants
+//-----------------------------------------------------------------------------
+
+#define TICK_HZ      1000              // System tick rate
+
+// Timer2 counts per tick, and in <us> microseconds for Tick_Spin, at full
+// speed. Both need SYSCLK from clock.h; at half speed Timer2 runs from a
+// reload of TICK_PERIOD >> Clock_Shift. TICK_COUNTS stays inside 32 bits up
+// to 35 ms.
+#define TICK_PERIOD      ((unsigned int)(SYSCLK/12/TICK_HZ))
+#define TICK_COUNTS(us)  ((unsigned int)((SYSCLK/12/100) * (us) / 10000L))
+
+#ifndef TIMER_COUNT
+#define TIMER_COUNT  4                 // Number of software timers
+#endif
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+typedef void (*Timer_Callback) (void);
+
+extern volatile unsigned int Tick_Count;
+extern unsigned char Idle_Percent;     // of the last second, in Tick_Idle
+extern unsigned int Idle_Wakeups;      // Tick_Idle returns, last second
+extern unsigned int Ready_Ms;          // Tick_Ready's tick, 0xFFFF before it
+
+//-----------------------------------------------------------------------------
+// Function Prototypes
+//-----------------------------------------------------------------------------
+
+void Tick_Init (void);
+unsigned int Tick_Now (void);
+unsigned char Tick_Expired (unsigned int deadline);
+void Tick_Delay (unsigned int ms);
+void Tick_Spin (unsigned int counts);
+void Tick_Idle (void);
+void Tick_Ready (void);
+
+void Timer_Start (unsigned char id, unsigned int delay, unsigned int period,
+                  Timer_Callback callback);
+void Timer_Stop (unsigned char id);
+void Timer_Service (void);
+
+INTERRUPT_PROTO (Timer2_ISR, INTERRUPT_TIMER2);
+
+#endif                                 // TIMER_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,176 @@
+//-----------------------------------------------------------------------------
+// uart.c
+//-----------------------------------------------------------------------------
+//
+// UART1 driver for the XBee link. See uart.h.
+//
+// Based on the SiLabs F02x_UART1_Interrupt example.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include <C8051F020_defs.h>            // SFR declarations
+#include "config.h"                    // Per-image settings
+#include "clock.h"
+#include "uart.h"
+
+#ifdef UART_RX_TASK
+#include "sched.h"
+#endif
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+unsigned char SEG_XDATA UART_Rx_Ring[UART_RX_RINGSIZE];
+volatile unsigned char UART_Rx_Head = 0;
+volatile unsigned char UART_Rx_Tail = 0;
+unsigned char UART_Rx_Overflows = 0;
+
+unsigned char SEG_XDATA UART_Tx_Slot[UART_TX_SLOTS][UART_TX_FRAMESIZE];
+volatile unsigned char UART_Tx_Length[UART_TX_SLOTS] = { 0, 0 };
+unsigned char UART_Tx_Stage = 0;
+unsigned char UART_Tx_Drain = 0;       // slot being sent (interrupt only)
+unsigned char UART_Tx_Index = 0;       // next byte to send (interrupt only)
+
+volatile unsigned char TX_Ready = 1;
+
+//-----------------------------------------------------------------------------
+// UART1_Init
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Configure the UART1 using Timer1, for <baudrate> and 8-N-1.
+// This routine configures the UART1 based on the following equation:
+//
+// Baud = (2^SMOD1/32)*(SYSCLK*12^(T1M-1))/(256-TH1)
+//
+// This equation can be found in the datasheet, Mode1 baud rate using timer1.
+// With SMOD1 = 1 and T1M = 1 that is SYSCLK/16/(256-TH1), which comes out
+// exact at the standard rates from a 22.1184 MHz crystal, and from half of
+// it; Clock_Set reloads TH1 whenever it changes SYSCLK.
+//
+// The UART1 interrupt bits are set on their own so whatever else the image
+// has enabled in EIE2 and EIP2 is left alone.
+//
+//-----------------------------------------------------------------------------
+void UART1_Init (void)
+{
+   SCON1   = 0x50;                     // SCON1: mode 1, 8-bit UART, enable RX
+
+   TMOD   &= ~0xF0;
+   TMOD   |=  0x20;                    // TMOD: timer 1, mode 2, 8-bit reload
+
+   PCON   |= 0x10;                     // SMOD1 (PCON.4) = 1 --> UART1 baudrate
+                                       // divide-by-two disabled
+   CKCON  |= 0x10;                     // Timer1 uses the SYSCLK
+   TH1     = 256 - (UART_TH1_COUNTS >> Clock_Shift);
+
+   TL1     = TH1;                      // init Timer1
+   TR1     = 1;                        // START Timer1
+   TX_Ready = 1;                       // Flag showing that UART can transmit
+   EIE2   |= 0x40;                     // Enable UART1 interrupts
+
+   EIP2   |= 0x40;                     // Make UART high priority
+}
+
+//-----------------------------------------------------------------------------
+// UART1_Tx_Send
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   :
+//   1) unsigned char length - bytes staged in UART1_Tx_Buffer()
+//
+// Hands the staged slot to the interrupt. If the transmitter is idle it is
+// started by setting TI1, otherwise the interrupt picks the slot up when the
+// current one is done. The length is published before TX_Ready is looked at,
+// so an interrupt that finishes the other slot in between either sees this
+// one queued or leaves TX_Ready set for us to restart it.
+//
+//-----------------------------------------------------------------------------
+void UART1_Tx_Send (unsigned char length)
+{
+   UART_Tx_Length[UART_Tx_Stage] = length;
+   UART_Tx_Stage = (UART_Tx_Stage + 1) & (UART_TX_SLOTS - 1);
+
+   if (TX_Ready == 1)
+   {
+      TX_Ready = 0;
+      SCON1 = (SCON1 | 0x02);
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Interrupt Service Routines
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// UART1_Interrupt
+//-----------------------------------------------------------------------------
+//
+// This routine is invoked whenever a byte is received from UART or transmitted.
+//
+//-----------------------------------------------------------------------------
+
+INTERRUPT (UART1_Interrupt, INTERRUPT_UART1)
+{
+   unsigned char next;
+
+   if ((SCON1 & 0x01) == 0x01)
+   {
+      SCON1 = (SCON1 & 0xFE);          // RI1 = 0;
+
+      next = (UART_Rx_Head + 1) & UART_RX_MASK;
+
+      if (next != UART_Rx_Tail)        // Drop the byte if the ring is full
+      {
+         UART_Rx_Ring[UART_Rx_Head] = SBUF1;
+
+         UART_Rx_Head = next;          // Publish it to main only after the
+                                       // byte itself is in the ring
+#ifdef UART_RX_TASK
+         Sched_Signal (UART_RX_TASK);
+#endif
+      }
+      else
+      {
+         UART_Rx_Overflows++;
+      }
+   }
+
+   if ((SCON1 & 0x02) == 0x02)         // Check if transmit flag is set
+   {
+      SCON1 = (SCON1 & 0xFD);
+
+      // Last byte of the current slot is out, so hand the slot back to main
+      // and move on to the other one
+      if (UART_Tx_Length[UART_Tx_Drain] != 0 &&
+          UART_Tx_Index == UART_Tx_Length[UART_Tx_Drain])
+      {
+         UART_Tx_Length[UART_Tx_Drain] = 0;
+         UART_Tx_Drain = (UART_Tx_Drain + 1) & (UART_TX_SLOTS - 1);
+         UART_Tx_Index = 0;
+      }
+
+      if (UART_Tx_Index < UART_Tx_Length[UART_Tx_Drain])
+      {
+         SBUF1 = UART_Tx_Slot[UART_Tx_Drain][UART_Tx_Index];
+         UART_Tx_Index++;
+      }
+      else
+      {
+         TX_Ready = 1;                 // Indicate transmission complete
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+// uart.h
+//-----------------------------------------------------------------------------
+//
+// Interrupt-driven UART1 link to the XBee, shared by the A/C control unit
+// and the thermostat. Timer1 sets the baud rate.
+//
+// Received bytes go into a ring that xbee.c drains a frame at a time; see
+// XBee_Receive. The ring is single producer (UART1_Interrupt owns the head)
+// and single consumer (main owns the tail), so neither side ever writes the
+// other's index and no interrupt masking is needed. One slot is always left
+// empty to tell "full" from "empty".
+//
+// Frames to send are built in one of two transmit slots, kept apart from
+// the receive ring. main stages a whole frame into the slot UART1_Tx_Buffer
+// returns while the interrupt drains the other, then hands it over with
+// UART1_Tx_Send. A slot belongs to the interrupt from the moment main sets
+// its length until the interrupt sets the length back to 0.
+//
+// Each image may set, in its config.h:
+//
+//    UART_RX_RINGSIZE   receive ring size, a power of two no larger than 256
+//                       so the 8-bit indices wrap with a single mask
+//    UART_RX_TASK       scheduler task to signal for every byte received
+//    UART_BAUDRATE      line rate in bps
+//    UART_TX_FRAMESIZE  bytes in each transmit slot, enough for the largest
+//                       frame the image sends
+//
+// Include after compiler_defs.h and config.h.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef UART_H
+#define UART_H
+
+//-----------------------------------------------------------------------------
+// Global Constants
+//-----------------------------------------------------------------------------
+
+#ifndef UART_RX_RINGSIZE
+#define UART_RX_RINGSIZE  64
+#endif
+
+#define UART_RX_MASK      (UART_RX_RINGSIZE - 1)
+
+#ifndef UART_BAUDRATE
+#define UART_BAUDRATE     9600         // Baud rate of UART in bps
+#endif
+
+// Timer1 counts per overflow at full speed; see UART1_Init
+#define UART_TH1_COUNTS   (SYSCLK/UART_BAUDRATE/16)
+
+#define UART_TX_SLOTS     2
+
+#ifndef UART_TX_FRAMESIZE
+#define UART_TX_FRAMESIZE 24
+#endif
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+extern unsigned char SEG_XDATA UART_Rx_Ring[UART_RX_RINGSIZE];
+extern volatile unsigned char UART_Rx_Head;
+extern volatile unsigned char UART_Rx_Tail;
+extern unsigned char UART_Rx_Overflows;   // bytes dropped on a full ring
+
+extern unsigned char SEG_XDATA UART_Tx_Slot[UART_TX_SLOTS][UART_TX_FRAMESIZE];
+extern volatile unsigned char UART_Tx_Length[UART_TX_SLOTS];
+extern unsigned char UART_Tx_Stage;       // slot main fills next (main only)
+
+extern volatile unsigned char TX_Ready;   // 1 while the transmitter is idle
+
+// The slot to build the next frame in, or 0 while both are still queued
+#define UART1_Tx_Buffer() \
+   (UART_Tx_Length[UART_Tx_Stage] ? 0 : UART_Tx_Slot[UART_Tx_Stage])
+
+//-----------------------------------------------------------------------------
+// Function Prototypes
+//-----------------------------------------------------------------------------
+
+void UART1_Init (void);
+void UART1_Tx_Send (unsigned char length);
+
+INTERRUPT_PROTO (UART1_Interrupt, INTERRUPT_UART1);
+
+#endif                                 // UART_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
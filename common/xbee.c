@@ -0,0 +1,331 @@
+//-----------------------------------------------------------------------------
+// xbee.c
+//-----------------------------------------------------------------------------
+//
+// Byte-at-a-time XBee API frame parser. See xbee.h for the frame layout.
+//
+// The parser is a small state machine so it never needs the whole frame to
+// be in memory before it starts, and it never needs to look back at bytes it
+// has already consumed. When a frame is bad (wrong length or checksum) the
+// parser simply drops back to hunting for the next start delimiter, so one
+// corrupt byte costs at most the frame it landed in.
+//
+// Transmit frames are written straight into a UART1 transmit slot, with the
+// checksum summed as the bytes go in.
+//
+// With XBEE_AP 2 both directions deal with escapes a byte at a time, so
+// neither needs a second buffer. On receive an escape only sets a flag and
+// the next byte is XORed back; a start delimiter always begins a new frame,
+// even in the middle of one. On transmit the few bytes that can need it are
+// checked and written as a pair.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include "config.h"                    // Per-image settings
+#include "uart.h"
+#include "xbee.h"
+
+//-----------------------------------------------------------------------------
+// Global Constants
+//-----------------------------------------------------------------------------
+
+#define XBEE_WAIT_START   0
+#define XBEE_LENGTH_MSB   1
+#define XBEE_LENGTH_LSB   2
+#define XBEE_DATA         3
+#define XBEE_CHECKSUM     4
+
+// Sum of the Transmit Request bytes that never change: the API identifier,
+// frame ID, eight 0xFF bytes of 64-bit address, radius 0 and the options
+#define XBEE_TX_FIXED_SUM ((XBEE_API_TX_REQUEST + XBEE_TX_FRAME_ID + \
+                            8 * 0xFF + XBEE_TX_OPTIONS) & 0xFF)
+
+#if XBEE_AP == 2
+#define XBEE_PUT(b)       p = XBee_Put (p, (b))
+#else
+#define XBEE_PUT(b)       *p++ = (b)
+#endif
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+unsigned char XBee_Frame[XBEE_MAX_FRAME];
+unsigned char XBee_Frame_Length = 0;
+
+unsigned char XBee_Checksum_Errors = 0;
+unsigned char XBee_Length_Errors = 0;
+
+static unsigned char XBee_State = XBEE_WAIT_START;
+static unsigned char XBee_Index = 0;
+static unsigned char XBee_Sum = 0;
+#if XBEE_AP == 2
+static unsigned char XBee_Escaped = 0; // the last byte was XBEE_ESCAPE
+#endif
+
+//-----------------------------------------------------------------------------
+// XBee_Reset
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Drops any partly received frame and waits for the next start delimiter.
+//
+//-----------------------------------------------------------------------------
+void XBee_Reset (void)
+{
+   XBee_State = XBEE_WAIT_START;
+#if XBEE_AP == 2
+   XBee_Escaped = 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// XBee_Parse
+//-----------------------------------------------------------------------------
+//
+// Return Value : 1 if <rxByte> completed a valid frame, otherwise 0
+// Parameters   :
+//   1) unsigned char rxByte - next byte from the UART
+//
+// Feeds one received byte to the parser. When this returns 1 the frame data
+// is in XBee_Frame and its length in XBee_Frame_Length. They stay valid until
+// the next byte is fed in.
+//
+// The checksum is 0xFF minus the low 8 bits of the sum of the frame data, so
+// the frame data plus the checksum must add up to 0xFF.
+//
+//-----------------------------------------------------------------------------
+unsigned char XBee_Parse (unsigned char rxByte)
+{
+#if XBEE_AP == 2
+   // Resynchronise on every start delimiter; one inside a frame means the
+   // rest of that frame was lost
+   if (rxByte == XBEE_START_DELIMITER)
+   {
+      if (XBee_State != XBEE_WAIT_START)
+      {
+         XBee_Length_Errors++;
+      }
+
+      XBee_Escaped = 0;
+      XBee_State = XBEE_LENGTH_MSB;
+      return 0;
+   }
+
+   if (rxByte == XBEE_ESCAPE)
+   {
+      XBee_Escaped = 1;
+      return 0;
+   }
+
+   if (XBee_Escaped)
+   {
+      XBee_Escaped = 0;
+      rxByte ^= 0x20;
+   }
+#endif
+
+   switch (XBee_State)
+   {
+      case XBEE_WAIT_START:
+         if (rxByte == XBEE_START_DELIMITER)
+         {
+            XBee_State = XBEE_LENGTH_MSB;
+         }
+         break;
+
+      case XBEE_LENGTH_MSB:
+         // Every frame we accept fits in one byte of length
+         if (rxByte != 0x00)
+         {
+            XBee_Length_Errors++;
+            XBee_State = XBEE_WAIT_START;
+         }
+         else
+         {
+            XBee_State = XBEE_LENGTH_LSB;
+         }
+         break;
+
+      case XBEE_LENGTH_LSB:
+         if (rxByte == 0 || rxByte > XBEE_MAX_FRAME)
+         {
+            XBee_Length_Errors++;
+            XBee_State = XBEE_WAIT_START;
+         }
+         else
+         {
+            XBee_Frame_Length = rxByte;
+            XBee_Index = 0;
+            XBee_Sum = 0;
+            XBee_State = XBEE_DATA;
+         }
+         break;
+
+      case XBEE_DATA:
+         XBee_Frame[XBee_Index++] = rxByte;
+         XBee_Sum += rxByte;
+
+         if (XBee_Index == XBee_Frame_Length)
+         {
+            XBee_State = XBEE_CHECKSUM;
+         }
+         break;
+
+      case XBEE_CHECKSUM:
+         XBee_State = XBEE_WAIT_START;
+
+         if ((unsigned char)(XBee_Sum + rxByte) == 0xFF)
+         {
+            return 1;
+         }
+
+         XBee_Checksum_Errors++;
+         break;
+   }
+
+   return 0;
+}
+
+//-----------------------------------------------------------------------------
+// XBee_Receive
+//-----------------------------------------------------------------------------
+//
+// Return Value : 1 if a complete, valid frame is now in XBee_Frame, else 0
+// Parameters   : None
+//
+// Feeds bytes from the UART1 receive ring to the parser until it reports a
+// whole frame or the ring runs dry. Whatever is left in the ring stays there
+// for the next call, so frames that arrive back to back are not lost.
+//
+//-----------------------------------------------------------------------------
+unsigned char XBee_Receive (void)
+{
+   unsigned char rxByte;
+
+   while (UART_Rx_Tail != UART_Rx_Head)
+   {
+      rxByte = UART_Rx_Ring[UART_Rx_Tail];
+      UART_Rx_Tail = (UART_Rx_Tail + 1) & UART_RX_MASK;
+
+      if (XBee_Parse (rxByte))
+      {
+         return 1;
+      }
+   }
+
+   return 0;
+}
+
+#if XBEE_AP == 2
+//-----------------------------------------------------------------------------
+// XBee_Put
+//-----------------------------------------------------------------------------
+//
+// Return Value : where the next byte goes
+// Parameters   :
+//   1) unsigned char SEG_XDATA *p - where <b> goes in the Tx slot
+//   2) unsigned char b - frame byte to write, escaped if need be
+//
+//-----------------------------------------------------------------------------
+static unsigned char SEG_XDATA *XBee_Put (unsigned char SEG_XDATA *p,
+                                          unsigned char b)
+{
+   if (b == XBEE_START_DELIMITER || b == XBEE_ESCAPE ||
+       b == XBEE_XON || b == XBEE_XOFF)
+   {
+      *p++ = XBEE_ESCAPE;
+      b ^= 0x20;
+   }
+
+   *p++ = b;
+
+   return p;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// XBee_Transmit
+//-----------------------------------------------------------------------------
+//
+// Return Value : 1 if the frame was queued, 0 if both Tx slots are busy
+// Parameters   :
+//   1) unsigned int addr16 - destination network address, or
+//                            XBEE_ADDR16_UNKNOWN
+//   2) unsigned char *payload - RF data to send
+//   3) unsigned char length - bytes of RF data
+//
+// Queues a ZigBee Transmit Request to <addr16>, with the 64-bit address
+// left at 0xFFFFFFFFFFFFFFFF so the XBee routes on the 16-bit one.
+//
+// The checksum is 0xFF minus the low 8 bits of the sum of the frame data.
+// The fixed header bytes are summed at compile time, so only the address and
+// the payload are added up here, in 8 bits since the carry is thrown away
+// anyway.
+//
+// Example for addr16 0xFFFE and payload 58 03:
+//
+//    7E 00 10 10 00 FF FF FF FF FF FF FF FF FF FE 00 01 58 03 9E
+//
+// and in mode 2 for payload 68 13, where the 0x13 is escaped and so is the
+// checksum, which comes out as 0x7E:
+//
+//    7E 00 10 10 00 FF FF FF FF FF FF FF FF FF FE 00 01 68 7D 33 7D 5E
+//
+//-----------------------------------------------------------------------------
+unsigned char XBee_Transmit (unsigned int addr16, unsigned char *payload,
+                             unsigned char length)
+{
+   unsigned char SEG_XDATA *frame = UART1_Tx_Buffer ();
+   unsigned char SEG_XDATA *p;
+   unsigned char sum;
+   unsigned char i;
+
+   if (frame == 0 || XBEE_TX_WORST(length) > UART_TX_FRAMESIZE)
+   {
+      return 0;
+   }
+
+   p = frame;
+
+   *p++ = XBEE_START_DELIMITER;
+   *p++ = 0x00;                        // Length MSB
+   XBEE_PUT (XBEE_TX_HEADER + length); // Length LSB
+   *p++ = XBEE_API_TX_REQUEST;
+   *p++ = XBEE_TX_FRAME_ID;
+
+   for (i = 0; i < 8; i++)
+   {
+      *p++ = 0xFF;                     // 64-bit address
+   }
+
+   XBEE_PUT (addr16 >> 8);
+   XBEE_PUT (addr16);
+   *p++ = 0x00;                        // broadcast radius, 0 = maximum
+   *p++ = XBEE_TX_OPTIONS;
+
+   sum = XBEE_TX_FIXED_SUM + (unsigned char)(addr16 >> 8) + (unsigned char)addr16;
+
+   for (i = 0; i < length; i++)
+   {
+      sum += payload[i];
+      XBEE_PUT (payload[i]);
+   }
+
+   XBEE_PUT (0xFF - sum);
+
+   UART1_Tx_Send (p - frame);          // the slot now belongs to the interrupt
+
+   return 1;
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
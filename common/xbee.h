@@ -0,0 +1,112 @@
+//-----------------------------------------------------------------------------
+// xbee.h
+//-----------------------------------------------------------------------------
+//
+// XBee API framing, shared by the A/C control unit and the thermostat.
+//
+// Received frames go through a streaming parser. Bytes are pushed in one at
+// a time, by XBee_Receive from the UART1 receive ring or straight into
+// XBee_Parse, and a whole, checksum-verified frame is handed back in
+// XBee_Frame. XBee_Transmit builds a ZigBee Transmit Request (0x10) in a
+// UART1 transmit slot.
+//
+// An API frame on the wire looks like this:
+//
+//    0x7E | length MSB | length LSB | frame data (length bytes) | checksum
+//
+// XBee_Frame holds only the frame data, so XBee_Frame[0] is the API
+// identifier (0x90 for a ZigBee Receive Packet) and XBee_Frame_Length is the
+// value of the length field.
+//
+// Each image sets XBEE_AP in its config.h to the API mode its radio is
+// configured for (ATAP). In mode 2 every byte after the start delimiter
+// that is 0x7E, 0x7D, 0x11 or 0x13 goes over the wire as 0x7D and the byte
+// XORed with 0x20, so a 0x7E is always the start of a frame. The length
+// and the checksum count the bytes before escaping. XBee_Parse removes the
+// escapes as the bytes come in and XBee_Transmit adds them as it writes the
+// frame, so XBee_Frame and everything reading it are the same in both modes.
+//
+// Both firmware projects put this directory on their include path and link
+// xbee.c and uart.c into the image. Include after compiler_defs.h and
+// config.h.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef XBEE_H
+#define XBEE_H
+
+//-----------------------------------------------------------------------------
+// Global Constants
+//-----------------------------------------------------------------------------
+
+#ifndef XBEE_AP
+#define XBEE_AP               1        // API mode, 1 or 2 (escaped)
+#endif
+
+#define XBEE_START_DELIMITER  0x7E
+#define XBEE_ESCAPE           0x7D     // next byte is XORed with 0x20
+#define XBEE_XON              0x11
+#define XBEE_XOFF             0x13
+
+// Largest frame data we keep. Longer frames are counted and skipped.
+#define XBEE_MAX_FRAME        32
+
+// API identifiers
+#define XBEE_API_TX_REQUEST   0x10     // ZigBee Transmit Request
+#define XBEE_API_RX_PACKET    0x90     // ZigBee Receive Packet
+
+// Offsets into XBee_Frame for a ZigBee Receive Packet (0x90)
+#define XBEE_RX_ADDR64        1        // 64-bit source address, MSB first
+#define XBEE_RX_ADDR16        9        // 16-bit source network address
+#define XBEE_RX_OPTIONS       11       // receive options
+#define XBEE_RX_DATA          12       // first byte of the RF payload
+
+// A ZigBee Transmit Request (0x10) carries 14 bytes of frame data ahead of
+// the payload: API identifier, frame ID, 64-bit and 16-bit destination
+// addresses, broadcast radius and options. Frame ID 0 asks the XBee not to
+// answer with a Transmit Status, which neither unit reads.
+#define XBEE_TX_HEADER        14
+#define XBEE_TX_FRAME_ID      0x00
+#define XBEE_TX_OPTIONS       0x01     // disable retries and route repair
+
+#define XBEE_ADDR16_UNKNOWN   0xFFFE   // send by 64-bit address only
+
+// Bytes a Transmit Request of <n> bytes of payload takes in a slot at most.
+// In mode 2 the length LSB, the 16-bit address, the payload and the
+// checksum may each be escaped; the fixed header bytes never need it.
+//
+// Both units run the radio in escaped mode (ATAP 2), which stays in step on
+// the mesh with flow control on. The price is the slot size: a 2-byte
+// payload goes from 20 bytes to 26, so an image built with XBEE_AP 2 sets
+// UART_TX_FRAMESIZE to XBEE_TX_WORST of its largest payload.
+#if XBEE_AP == 2
+#define XBEE_TX_WORST(n)      (4 + XBEE_TX_HEADER + (n) + 4 + (n))
+#else
+#define XBEE_TX_WORST(n)      (4 + XBEE_TX_HEADER + (n))
+#endif
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+extern unsigned char XBee_Frame[XBEE_MAX_FRAME];
+extern unsigned char XBee_Frame_Length;
+
+extern unsigned char XBee_Checksum_Errors; // frames dropped on a bad checksum
+extern unsigned char XBee_Length_Errors;   // frames dropped on a bad length
+
+//-----------------------------------------------------------------------------
+// Function Prototypes
+//-----------------------------------------------------------------------------
+
+void XBee_Reset (void);
+unsigned char XBee_Parse (unsigned char rxByte);
+unsigned char XBee_Receive (void);
+unsigned char XBee_Transmit (unsigned int addr16, unsigned char *payload,
+                             unsigned char length);
+
+#endif                                 // XBEE_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,566 @@
+//-----------------------------------------------------------------------------
+// control_unit_sim.cpp
+//-----------------------------------------------------------------------------
+//
+// Runs the A/C control unit firmware against simulated hardware:
+//
+//    - four remote nodes and the thermostat sending readings over the radio,
+//      one of which goes quiet part way through,
+//    - a DHT11 on CEX0 reporting the coolant temperature,
+//    - the four CD4543B latched 7-segment digits on P2,
+//    - the relay on P1.2 and the LEDs on P5.
+//
+// At the end it prints what the firmware did and checks it against what
+// the inputs should have produced.
+//
+// Usage: control-unit-sim [--seconds N] [--bench FRAMES]
+//
+// --bench skips the scenario and pushes FRAMES radio frames through the
+// firmware's frame task as fast as the host allows.
+//
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "radio.h"
+#include "scenario.h"
+#include "sched.h"
+#include "xbee.h"
+#include "nodes.h"
+#include "timer.h"
+#include "filter.h"
+
+//-----------------------------------------------------------------------------
+// Firmware symbols
+//-----------------------------------------------------------------------------
+
+void Firmware_Main (void);
+void Frame_Task (void);
+
+extern unsigned char UART_Rx_Ring[];
+extern volatile unsigned char UART_Rx_Head;
+extern volatile unsigned char UART_Rx_Tail;
+extern unsigned char UART_Rx_Overflows;
+extern volatile unsigned char UART_Tx_Length[];
+extern unsigned char UART_Tx_Slot[][UART_TX_FRAMESIZE];
+extern unsigned char UART_Tx_Stage;
+extern volatile unsigned char TX_Ready;
+extern signed int internal_temp;
+extern unsigned char DHT11_Checksum_Errors;
+extern unsigned char DHT11_Timeouts;
+extern unsigned short AVG_Temp;
+extern unsigned short SET_Temp;
+extern unsigned char State;
+extern Filter_MA AVG_Filter;
+extern Sched_Task Tasks[];
+extern unsigned char Idle_Percent;
+extern unsigned int Idle_Wakeups;
+extern unsigned int Ready_Ms;
+
+static const char *Task_Names[] = { "frame", "sensor", "control", "display", "leds", "nodes" };
+
+#define TASK_COUNT  (sizeof(Task_Names) / sizeof(Task_Names[0]))
+
+//-----------------------------------------------------------------------------
+// DHT11 on CEX0
+//-----------------------------------------------------------------------------
+//
+// Answers a start signal of at least 18 ms, the datasheet's minimum, with
+// the response and 40 data bits, timed as in the datasheet. Only falling
+// edges are modelled since that is all the firmware captures.
+//
+//-----------------------------------------------------------------------------
+
+static struct
+{
+   unsigned char humidity;
+   unsigned char temp_c;
+   bool low;
+   Sim_Time low_since;
+   unsigned long reads;
+} Dht11 = { 40, 15, false, 0, 0 };
+
+static void Dht11_Respond (void)
+{
+   unsigned char data[5];
+   Sim_Time t = Sim_Now() + 30 * SIM_US;
+   int i;
+
+   data[0] = Dht11.humidity;
+   data[1] = 0;
+   data[2] = Dht11.temp_c;
+   data[3] = 0;
+   data[4] = data[0] + data[1] + data[2] + data[3];
+
+   Dht11.reads++;
+
+   // Response: 80 us low, 80 us high
+   Sim_At(t, [] () { Sim_Pca_Edge(0, false); });
+   t += 160 * SIM_US;
+
+   // Each bit: 50 us low, then 26 us (0) or 70 us (1) high
+   for (i = 0; i < 40; i++)
+   {
+      Sim_At(t, [] () { Sim_Pca_Edge(0, false); });
+      t += 50 * SIM_US;
+      t += ((data[i >> 3] >> (7 - (i & 7))) & 1) ? 70 * SIM_US : 26 * SIM_US;
+   }
+
+   // Final 50 us low before the line is released
+   Sim_At(t, [] () { Sim_Pca_Edge(0, false); });
+}
+
+static void Dht11_Line (unsigned char before, unsigned char after)
+{
+   bool low = Sim_Pca_Cex_Low(0);
+
+   (void)before;
+   (void)after;
+
+   if (low && !Dht11.low)
+   {
+      Dht11.low_since = Sim_Now();
+   }
+   else if (!low && Dht11.low && Sim_Now() - Dht11.low_since >= 18 * SIM_MS)
+   {
+      Dht11_Respond();
+   }
+
+   Dht11.low = low;
+}
+
+//-----------------------------------------------------------------------------
+// CD4543B latches and 7-segment digits on P2
+//-----------------------------------------------------------------------------
+//
+// Even pins are the latch enables of digits 0-3, odd pins the BCD inputs.
+// A digit follows the BCD inputs while its latch enable is high. A write
+// that moves the BCD inputs while a latch is open is counted as a glitch:
+// that digit either shows the passing value, or, if its latch closes in
+// the same write, may keep either one.
+//
+//-----------------------------------------------------------------------------
+
+#define SEGMENTS_LATCHES  0x55
+#define SEGMENTS_BCD      0xAA
+
+static unsigned char Digit[4];
+static unsigned long Digit_Changes[4];
+static unsigned long Digit_Glitches = 0;
+
+static void Segments_Update (unsigned char before, unsigned char after)
+{
+   unsigned char bcd;
+   int n;
+
+   if ((before & SEGMENTS_LATCHES) && ((before ^ after) & SEGMENTS_BCD))
+   {
+      Digit_Glitches++;
+   }
+
+   bcd = ((after >> 1) & 1) | (((after >> 3) & 1) << 1) |
+         (((after >> 5) & 1) << 2) | (((after >> 7) & 1) << 3);
+
+   for (n = 0; n < 4; n++)
+   {
+      if ((after & (1 << (2 * n))) && Digit[n] != bcd)
+      {
+         Digit[n] = bcd;
+         Digit_Changes[n]++;
+      }
+   }
+}
+
+static int Shown (int output)
+{
+   return Digit[output * 2] * 10 + Digit[output * 2 + 1];
+}
+
+//-----------------------------------------------------------------------------
+// Relay on P1.2, active low
+//-----------------------------------------------------------------------------
+
+static unsigned long Relay_Switches = 0;
+
+static void Relay_Update (unsigned char before, unsigned char after)
+{
+   if ((before ^ after) & 0x04)
+   {
+      Relay_Switches++;
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Radio
+//-----------------------------------------------------------------------------
+
+struct Node
+{
+   uint64_t addr64;
+   uint16_t addr16;
+   Radio_Bytes payload;
+   Sim_Time first;
+   Sim_Time period;
+   Sim_Time last;                      // no frames after this
+};
+
+static void Node_Send (const Node &node, Sim_Time when)
+{
+   if (when > node.last)
+   {
+      return;
+   }
+
+   Sim_At(when, [node, when] ()
+   {
+      Sim_Uart1_Inject(Radio_Rx_Packet(node.addr64, node.addr16, node.payload,
+                                       XBEE_AP == 2));
+      Node_Send(node, when + node.period);
+   });
+}
+
+static Radio_Decoder Tx_Decoder(XBEE_AP == 2);
+static Radio_Tx_Request Last_Tx;
+static unsigned long Tx_Frames = 0;
+static unsigned long Tx_Bad_Frames = 0;
+
+static void Tx_Byte (unsigned char b)
+{
+   Radio_Tx_Request request;
+
+   First_Tx();
+
+   if (!Tx_Decoder.Feed(b))
+   {
+      return;
+   }
+
+   if (!Tx_Decoder.Tx_Request(&request) || request.payload.size() != 2)
+   {
+      Tx_Bad_Frames++;
+      return;
+   }
+
+   Last_Tx = request;
+   Tx_Frames++;
+}
+
+// The reply in the scenario never needs escaping, so XBee_Transmit's
+// escaping is checked on its own, after the run: a frame that needs it in
+// the address, the payload and the checksum is built in a Tx slot and read
+// back through the radio's decoder. TX_Ready is cleared first, so it is
+// only queued and never reaches the UART.
+static bool Tx_Escape_Loopback (void)
+{
+   unsigned char payload[2] = { 0x7D, 0x6C };  // checksum comes out 0x7E
+   unsigned char slot;
+   Radio_Decoder decoder(XBEE_AP == 2);
+   Radio_Tx_Request request;
+   bool whole = false;
+   int i;
+
+   TX_Ready = 0;
+   UART_Tx_Length[0] = 0;
+   UART_Tx_Length[1] = 0;
+   slot = UART_Tx_Stage;
+
+   if (!XBee_Transmit(0x7E11, payload, 2))
+   {
+      return false;
+   }
+
+   for (i = 0; i < UART_Tx_Length[slot]; i++)
+   {
+      whole = decoder.Feed(UART_Tx_Slot[slot][i]);
+   }
+
+   return whole && decoder.Tx_Request(&request) &&
+          request.addr16 == 0x7E11 &&
+          request.payload == Radio_Bytes(payload, payload + 2) &&
+          decoder.escapes == (XBEE_AP == 2 ? 4 : 0);
+}
+
+// Radios get a new network address every time they rejoin, so over weeks
+// the table sees far more than NODE_MAX addresses. This runs five rounds of
+// NODE_MAX new nodes, each round timing out before the next joins, straight
+// against the table after the run. Every round must fit, and once the table
+// is full of live nodes the next new one must be the only one dropped.
+static bool Node_Churn (void)
+{
+   unsigned int addr = 0x2000;
+   unsigned int round;
+   unsigned int i;
+
+   Node_Init();
+   Node_Full = 0;
+
+   for (round = 0; round < 5; round++)
+   {
+      for (i = 0; i < NODE_MAX; i++)
+      {
+         Node_Update(addr++, NULL, 70);
+      }
+
+      if (Node_Live != NODE_MAX || Node_Full != 0)
+      {
+         return false;
+      }
+
+      // A node heard again must still be found, not added twice
+      Node_Update(addr - NODE_MAX / 2, NULL, 70);
+
+      if (Node_Live != NODE_MAX || Node_Full != 0)
+      {
+         return false;
+      }
+
+      Tick_Count += NODE_TIMEOUT + 1;
+      Node_Age();
+
+      if (Node_Live != 0)
+      {
+         return false;
+      }
+   }
+
+   for (i = 0; i < NODE_MAX + 1; i++)
+   {
+      Node_Update(addr++, NULL, 70);
+   }
+
+   return Node_Live == NODE_MAX && Node_Full == 1 &&
+          Node_Average() == 70;
+}
+
+//-----------------------------------------------------------------------------
+// Scenario
+//-----------------------------------------------------------------------------
+
+static int Run_Scenario (unsigned int seconds)
+{
+   const uint64_t oui = 0x0013A20040A1B200ULL;
+   Node nodes[] =
+   {
+      { oui | 0x01, 0x1A2B, Radio_Bytes(1, 78), 500 * SIM_MS, 2000 * SIM_MS, ~0ULL },
+      { oui | 0x02, 0x3C4D, Radio_Bytes(1, 74), 700 * SIM_MS, 3000 * SIM_MS, ~0ULL },
+      { oui | 0x03, 0xFFFE, Radio_Bytes(1, 80), 900 * SIM_MS, 2500 * SIM_MS, 10 * SIM_S },
+      { oui | 0x04, 0x8949, Radio_Bytes(), 1000 * SIM_MS, 1800 * SIM_MS, ~0ULL },
+   };
+   Radio_Bytes corrupt;
+   const Sim_Uart_Stats *uart = &Sim_Uart1_Stats();
+   unsigned int i;
+   char name[32];
+
+   // The thermostat sends its set point and its own reading
+   nodes[3].payload.push_back(72);
+   nodes[3].payload.push_back(76);
+
+   for (i = 0; i < sizeof(nodes) / sizeof(nodes[0]); i++)
+   {
+      Node_Send(nodes[i], nodes[i].first);
+   }
+
+   // One frame with a bad checksum, which must be dropped
+   corrupt = Radio_Rx_Packet(oui | 0x05, 0x5E6F, Radio_Bytes(1, 20), XBEE_AP == 2);
+   corrupt.back() ^= 0x55;
+   Sim_At(5 * SIM_S, [corrupt] () { Sim_Uart1_Inject(corrupt); });
+
+   Sim_On_Write(0xDA, Dht11_Line);               // PCA0CPM0
+   Sim_On_Write(SIM_P2, Segments_Update);
+   Sim_On_Write(SIM_P1, Relay_Update);
+   Sim_Uart1_On_Tx(Tx_Byte);
+
+   Idle_Mark(seconds * SIM_S);
+   Ready_Watch(&Ready_Ms);
+   Sim_Run(Firmware_Main, seconds * SIM_S);
+
+   Report("sim_seconds", seconds);
+   Report("sysclk_hz", Sim_Sysclk());
+   Report("sysclk_switches", Sim_Clock_Switches());
+   Report("xosc_live_writes", Sim_Xosc_Live_Writes());
+   Report("uart1_baud", Sim_Uart1_Baud());
+   Report("uart1_rx_bytes", uart->rx_bytes);
+   Report("uart1_rx_overruns", uart->rx_overruns);
+   Report("uart1_rx_framing_errors", uart->rx_framing_errors);
+   Report("uart1_tx_bytes", uart->tx_bytes);
+   Report("uart1_tx_collisions", uart->tx_collisions);
+   Report("rx_ring_overflows", UART_Rx_Overflows);
+   Report("xbee_checksum_errors", XBee_Checksum_Errors);
+   Report("xbee_length_errors", XBee_Length_Errors);
+   Report("tx_frames", Tx_Frames);
+   Report("dht11_reads", Dht11.reads);
+   Report("dht11_checksum_errors", DHT11_Checksum_Errors);
+   Report("dht11_timeouts", DHT11_Timeouts);
+   Report("internal_temp_tenths", internal_temp);
+   Report("nodes_live", Node_Live);
+   Report("avg_temp", AVG_Temp);
+   Report("set_temp", SET_Temp);
+   Report("state", State);
+   Report("display_set", Shown(0));
+   Report("display_avg", Shown(1));
+   Report("display_glitches", Digit_Glitches);
+   Report("relay_switches", Relay_Switches);
+   Report("leds", Sim_Latch(SIM_P5) & 0xF0);
+   Report("interrupts_timer2", Sim_Interrupts(5));
+   Report("interrupts_pca0", Sim_Interrupts(9));
+   Report("interrupts_uart1", Sim_Interrupts(20));
+   Report("idle_ms", Sim_Idle_Time() / SIM_MS);
+   Boot_Report(Ready_Ms);
+   Idle_Report(Idle_Percent, Idle_Wakeups);
+
+   for (i = 0; i < TASK_COUNT; i++)
+   {
+      snprintf(name, sizeof(name), "task_%s_worst_ms", Task_Names[i]);
+      Report(name, Tasks[i].worst);
+      snprintf(name, sizeof(name), "task_%s_overruns", Task_Names[i]);
+      Report(name, Tasks[i].overruns);
+   }
+
+   // 15 C is 59.0 F; the last node to go quiet stopped at 10 s and times
+   // out 30 s later, leaving 78, 74 and 76
+   Check_Equal("uart1_rx_overruns", uart->rx_overruns, 0);
+   // Clock_Set runs with bytes on the line; none may be mistimed, and the
+   // tick must keep to 1 ms within 0.1% (less the start-up) at either speed
+   Check_Equal("uart1_framing_errors", uart->rx_framing_errors, 0);
+   // Full speed is taken once per frame and per DHT11 read, under twice a
+   // second here, and not for each of the 27 bytes a second received
+   Check("sysclk_switches", Sim_Clock_Switches() > 2 &&
+                            Sim_Clock_Switches() < seconds * 6);
+   // Each switch goes by way of the internal oscillator
+   Check_Equal("xosc_live_writes", Sim_Xosc_Live_Writes(), 0);
+   Check("tick_rate", Sim_Interrupts(5) >= seconds * 999 - 50 &&
+                      Sim_Interrupts(5) <= seconds * 1001);
+   Check_Equal("uart1_tx_collisions", uart->tx_collisions, 0);
+   Check_Equal("rx_ring_overflows", UART_Rx_Overflows, 0);
+   Check_Equal("xbee_checksum_errors", XBee_Checksum_Errors, 1);
+   Check_Equal("dht11_errors", DHT11_Checksum_Errors + DHT11_Timeouts, 0);
+   Check_Equal("internal_temp_tenths", internal_temp, 590);
+   Check_Equal("nodes_live", Node_Live, 3);
+   Check_Equal("avg_temp", AVG_Temp, 76);
+   Check_Equal("set_temp", SET_Temp, 72);
+   Check_Equal("display_set", Shown(0), 72);
+   Check_Equal("display_avg", Shown(1), 76);
+   Check_Equal("display_glitches", Digit_Glitches, 0);
+   Check_Equal("state", State, 0x01);
+   Check_Equal("relay_on", Sim_Latch(SIM_P1) & 0x04, 0);
+   Check_Equal("leds", Sim_Latch(SIM_P5) & 0xF0, 0x30);
+   Check("tx_frames", Tx_Frames > 0 && Tx_Bad_Frames == 0);
+   Check_Equal("tx_addr16", Last_Tx.addr16, 0x8949);
+   Check("tx_escape_loopback", Tx_Escape_Loopback());
+   Check_Equal("tx_avg_temp", Last_Tx.payload.size() == 2 ? Last_Tx.payload[0] : -1, 76);
+   Check_Equal("tx_state", Last_Tx.payload.size() == 2 ? Last_Tx.payload[1] : -1, 0x01);
+   Check("node_churn", Node_Churn());
+   // Up once the crystal has started, and replying to the first frame, in
+   // by 518 ms, without waiting on the DHT11
+   Boot_Check(Ready_Ms, 5 * SIM_MS, 520 * SIM_MS);
+   Idle_Check(Idle_Percent, Idle_Wakeups);
+
+   return Scenario_Failures;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+//
+// Fills the receive ring with as many whole frames as fit and runs the frame
+// task over them, over and over. Replies are discarded by handing the Tx
+// slots straight back, so this measures the receive, node table, filter and
+// reply-building path and not the UART.
+//
+//-----------------------------------------------------------------------------
+
+static int Run_Bench (unsigned long frames)
+{
+   Radio_Bytes stream;
+   Radio_Bytes frame;
+   unsigned long done = 0;
+   unsigned int perFill = 0;
+   unsigned int i;
+   clock_t start;
+   double seconds;
+
+   Node_Init();
+   Filter_MA_Init(&AVG_Filter);
+   TX_Ready = 0;
+
+   // A dozen distinct nodes, so the table lookup does real work
+   while (stream.size() + 32 < 255)
+   {
+      frame = Radio_Rx_Packet(0x0013A20040000000ULL | perFill,
+                              0x1000 + perFill * 0x0101,
+                              Radio_Bytes(1, 70 + (perFill & 7)),
+                              XBEE_AP == 2);
+      stream.insert(stream.end(), frame.begin(), frame.end());
+      perFill++;
+   }
+
+   start = clock();
+
+   while (done < frames)
+   {
+      UART_Rx_Tail = 0;
+      for (i = 0; i < stream.size(); i++)
+      {
+         UART_Rx_Ring[i] = stream[i];
+      }
+      UART_Rx_Head = stream.size();
+
+      Frame_Task();
+
+      UART_Tx_Length[0] = UART_Tx_Length[1] = 0;
+      done += perFill;
+   }
+
+   seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+   Report("bench_frames", done);
+   Report("bench_frames_per_second", seconds > 0 ? (long long)(done / seconds) : 0);
+   Report("bench_sfr_accesses_per_frame", (long long)(Sim_Accesses() / done));
+
+   return 0;
+}
+
+//-----------------------------------------------------------------------------
+// main
+//-----------------------------------------------------------------------------
+
+int main (int argc, char **argv)
+{
+   unsigned int seconds = 60;
+   unsigned long bench = 0;
+   int i;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+      {
+         seconds = atoi(argv[++i]);
+      }
+      else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+      {
+         bench = strtoul(argv[++i], 0, 10);
+      }
+      else
+      {
+         fprintf(stderr, "usage: %s [--seconds N] [--bench FRAMES]\n", argv[0]);
+         return 2;
+      }
+   }
+
+   Sim_Init();
+
+   if (bench != 0)
+   {
+      return Run_Bench(bench);
+   }
+
+   return Run_Scenario(seconds);
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,72 @@
+//-----------------------------------------------------------------------------
+// compiler_defs.h (host simulation)
+//-----------------------------------------------------------------------------
+//
+// Stands in for the SiLabs compiler_defs.h when the firmware is compiled as
+// C++ for the host. It comes first on the include path, so the unmodified
+// C8051F020_defs.h that follows declares every SFR and SBIT as a proxy from
+// sim.h, and every INTERRUPT registers its ISR with the simulator.
+//
+// The 8051 int is 16 bits wide and the host int is 32, so firmware that
+// relies on 16-bit wrap-around has to say so with a cast to unsigned short.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef COMPILER_DEFS_H
+#define COMPILER_DEFS_H
+
+#include <stdint.h>
+#include "sim.h"
+
+#define bit  unsigned char
+#define code const
+
+# define SEG_GENERIC
+# define SEG_FAR
+# define SEG_DATA
+# define SEG_NEAR
+# define SEG_IDATA
+# define SEG_XDATA
+# define SEG_PDATA
+# define SEG_CODE  const
+# define SEG_BDATA
+
+# define SBIT(name, addr, bit)  static Sim_Bit   name ((addr), (bit))
+# define SFR(name, addr)        static Sim_Sfr   name (addr)
+# define SFR16(name, addr)      static Sim_Sfr16 name (addr)
+
+# define INTERRUPT_PROTO(name, vector) void name (void)
+# define INTERRUPT_PROTO_USING(name, vector, regnum) void name (void)
+# define INTERRUPT(name, vector) \
+   void name (void); \
+   static Sim_Vector name##_Vector ((vector), name); \
+   void name (void)
+# define INTERRUPT_USING(name, vector, regnum) INTERRUPT (name, vector)
+
+# define FUNCTION_USING(name, return_value, parameter, regnum) return_value name (parameter)
+# define FUNCTION_PROTO_USING(name, return_value, parameter, regnum) return_value name (parameter)
+
+# define SEGMENT_VARIABLE(name, vartype, locsegment) vartype name
+# define VARIABLE_SEGMENT_POINTER(name, vartype, targsegment) vartype * name
+# define SEGMENT_VARIABLE_SEGMENT_POINTER(name, vartype, targsegment, locsegment) vartype * name
+# define SEGMENT_POINTER(name, vartype, locsegment) vartype * name
+
+// used with UU16
+# define LSB 0
+# define MSB 1
+
+typedef uint8_t U8;
+typedef uint16_t U16;
+typedef uint32_t U32;
+
+typedef int8_t S8;
+typedef int16_t S16;
+typedef int32_t S32;
+
+#define NOP() Sim_Nop ()
+
+#endif                                 // #define COMPILER_DEFS_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,188 @@
+//-----------------------------------------------------------------------------
+// radio.cpp
+//-----------------------------------------------------------------------------
+//
+// XBee API frame helpers for the simulation scenarios. See radio.h.
+//
+//-----------------------------------------------------------------------------
+
+#include "radio.h"
+
+#define ESCAPE 0x7D
+
+enum
+{
+   WAIT_START,
+   LENGTH_MSB,
+   LENGTH_LSB,
+   DATA,
+   CHECKSUM
+};
+
+static bool Radio_Special (unsigned char b)
+{
+   return b == 0x7E || b == ESCAPE || b == 0x11 || b == 0x13;
+}
+
+Radio_Bytes Radio_Rx_Packet (uint64_t addr64, uint16_t addr16,
+                             const Radio_Bytes &payload, bool escaped)
+{
+   Radio_Bytes data;
+   Radio_Bytes frame;
+   unsigned char sum = 0;
+   int i;
+
+   data.push_back(0x90);
+
+   for (i = 7; i >= 0; i--)
+   {
+      data.push_back((unsigned char)(addr64 >> (i * 8)));
+   }
+
+   data.push_back((unsigned char)(addr16 >> 8));
+   data.push_back((unsigned char)addr16);
+   data.push_back(0x01);                         // packet acknowledged
+   data.insert(data.end(), payload.begin(), payload.end());
+
+   frame.push_back(0x7E);
+   frame.push_back((unsigned char)(data.size() >> 8));
+   frame.push_back((unsigned char)data.size());
+
+   for (i = 0; i < (int)data.size(); i++)
+   {
+      frame.push_back(data[i]);
+      sum += data[i];
+   }
+
+   frame.push_back(0xFF - sum);
+
+   if (!escaped)
+   {
+      return frame;
+   }
+
+   Radio_Bytes wire(1, frame[0]);
+
+   for (i = 1; i < (int)frame.size(); i++)
+   {
+      if (Radio_Special(frame[i]))
+      {
+         wire.push_back(ESCAPE);
+         wire.push_back(frame[i] ^ 0x20);
+      }
+      else
+      {
+         wire.push_back(frame[i]);
+      }
+   }
+
+   return wire;
+}
+
+Radio_Decoder::Radio_Decoder (bool escaped)
+   : frames(0), checksum_errors(0), skipped(0), escapes(0),
+     escaped_(escaped), escape_next_(false),
+     state_(WAIT_START), length_(0), sum_(0)
+{
+}
+
+bool Radio_Decoder::Feed (unsigned char b)
+{
+   if (escaped_ && state_ != WAIT_START)
+   {
+      if (b == ESCAPE)
+      {
+         escape_next_ = true;
+         return false;
+      }
+
+      if (escape_next_)
+      {
+         escape_next_ = false;
+         b ^= 0x20;
+         escapes++;
+      }
+      else if (Radio_Special(b))
+      {
+         // A special byte sent as it is: the frame is broken, and a 0x7E
+         // starts the next one
+         checksum_errors++;
+         state_ = b == 0x7E ? LENGTH_MSB : WAIT_START;
+         return false;
+      }
+   }
+
+   switch (state_)
+   {
+   case WAIT_START:
+      if (b == 0x7E)
+      {
+         state_ = LENGTH_MSB;
+      }
+      else
+      {
+         skipped++;
+      }
+      return false;
+
+   case LENGTH_MSB:
+      length_ = b << 8;
+      state_ = LENGTH_LSB;
+      return false;
+
+   case LENGTH_LSB:
+      length_ |= b;
+      frame_.clear();
+      sum_ = 0;
+      state_ = length_ == 0 ? WAIT_START : DATA;
+      return false;
+
+   case DATA:
+      frame_.push_back(b);
+      sum_ += b;
+      if (frame_.size() == length_)
+      {
+         state_ = CHECKSUM;
+      }
+      return false;
+
+   default:
+      state_ = WAIT_START;
+      if ((unsigned char)(sum_ + b) != 0xFF)
+      {
+         checksum_errors++;
+         return false;
+      }
+      frames++;
+      return true;
+   }
+}
+
+bool Radio_Decoder::Tx_Request (Radio_Tx_Request *request) const
+{
+   int i;
+
+   if (frame_.size() < 14 || frame_[0] != 0x10)
+   {
+      return false;
+   }
+
+   request->frame_id = frame_[1];
+   request->addr64 = 0;
+
+   for (i = 0; i < 8; i++)
+   {
+      request->addr64 = (request->addr64 << 8) | frame_[2 + i];
+   }
+
+   request->addr16 = (frame_[10] << 8) | frame_[11];
+   request->radius = frame_[12];
+   request->options = frame_[13];
+   request->payload.assign(frame_.begin() + 14, frame_.end());
+
+   return true;
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
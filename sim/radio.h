@@ -0,0 +1,68 @@
+//-----------------------------------------------------------------------------
+// radio.h
+//-----------------------------------------------------------------------------
+//
+// The XBee side of the serial link for the simulation scenarios: builds the
+// API frames a radio would hand the firmware, and decodes what the firmware
+// sends back. Written separately from common/xbee.c on purpose, so the
+// firmware parser is checked against an independent implementation.
+//
+// <escaped> selects API mode 2 (ATAP 2) for both: bytes after the start
+// delimiter that are 0x7E, 0x7D, 0x11 or 0x13 go over the wire as 0x7D and
+// the byte XORed with 0x20.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef RADIO_H
+#define RADIO_H
+
+#include <stdint.h>
+#include <vector>
+
+typedef std::vector<unsigned char> Radio_Bytes;
+
+// ZigBee Receive Packet (0x90) from <addr64>/<addr16> carrying <payload>
+Radio_Bytes Radio_Rx_Packet (uint64_t addr64, uint16_t addr16,
+                             const Radio_Bytes &payload, bool escaped);
+
+// Frame data of a Transmit Request (0x10), as sent by the firmware
+struct Radio_Tx_Request
+{
+   unsigned char frame_id;
+   uint64_t addr64;
+   uint16_t addr16;
+   unsigned char radius;
+   unsigned char options;
+   Radio_Bytes payload;
+};
+
+class Radio_Decoder
+{
+public:
+   explicit Radio_Decoder (bool escaped);
+
+   // Returns true when <b> completes a frame with a good checksum
+   bool Feed (unsigned char b);
+
+   const Radio_Bytes &Frame (void) const { return frame_; }
+   bool Tx_Request (Radio_Tx_Request *request) const;
+
+   unsigned long frames;
+   unsigned long checksum_errors;
+   unsigned long skipped;              // bytes outside any frame
+   unsigned long escapes;              // escaped bytes, in mode 2
+
+private:
+   bool escaped_;
+   bool escape_next_;
+   int state_;
+   unsigned int length_;
+   unsigned char sum_;
+   Radio_Bytes frame_;
+};
+
+#endif                                 // RADIO_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,152 @@
+//-----------------------------------------------------------------------------
+// scenario.h
+//-----------------------------------------------------------------------------
+//
+// Reporting helpers shared by the scenario drivers. Results are printed one
+// per line as "name value", and checks as "check name ok|FAIL", so runs can
+// be diffed or grepped. The driver's exit status is the number of failures.
+//
+// Idle_Mark, Idle_Report and Idle_Check measure the last second of a run
+// and check the firmware's own Idle_Percent against it. The firmware counts
+// the interrupt that wakes it as idle time, and the few SFR accesses on
+// either side of IDLE that time it, so its figure should lie between the
+// time the simulator spent in IDLE and that plus the time in interrupts and
+// IDLE_STAMP_ACCESSES per wake-up.
+//
+// Ready_Watch and First_Tx time start-up from reset: the first polls the
+// firmware's Ready_Ms every 100 us for when Tick_Ready set it, and the
+// second, called from the driver's UART1 Tx hook, notes the first byte out.
+// Boot_Report prints both along with the firmware's own Ready_Ms, which
+// counts from Tick_Init and so should not be ahead of the simulator's.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <stdio.h>
+
+#include "sim.h"
+
+#define IDLE_STAMP_ACCESSES 6          // Timer2 and PCON reads in Tick_Idle
+
+static int Scenario_Failures = 0;
+static Sim_Time Scenario_Idle_Mark = 0;
+static Sim_Time Scenario_Isr_Mark = 0;
+static Sim_Time Scenario_Ready = 0;
+static Sim_Time Scenario_First_Tx = 0;
+
+static inline void Report (const char *name, long long value)
+{
+   printf("%-28s %lld\n", name, value);
+}
+
+static inline void Check (const char *name, bool ok)
+{
+   printf("check %-22s %s\n", name, ok ? "ok" : "FAIL");
+
+   if (!ok)
+   {
+      Scenario_Failures++;
+   }
+}
+
+static inline void Check_Equal (const char *name, long long actual, long long expected)
+{
+   if (actual != expected)
+   {
+      printf("check %-22s FAIL (got %lld, expected %lld)\n", name, actual, expected);
+      Scenario_Failures++;
+      return;
+   }
+
+   Check(name, true);
+}
+
+// Call before Sim_Run with the run's length
+static inline void Idle_Mark (Sim_Time end)
+{
+   Sim_At(end - SIM_S, [] ()
+   {
+      Scenario_Idle_Mark = Sim_Idle_Time();
+      Scenario_Isr_Mark = Sim_Isr_Time();
+   });
+}
+
+static inline long long Idle_Last_Percent (void)
+{
+   return (Sim_Idle_Time() - Scenario_Idle_Mark) * 100 / SIM_S;
+}
+
+static inline long long Isr_Last_Percent (void)
+{
+   return (Sim_Isr_Time() - Scenario_Isr_Mark) * 100 / SIM_S;
+}
+
+// Time Tick_Idle spends timing <wakeups> wake-ups, in percent of a second
+static inline long long Idle_Stamp_Percent (long long wakeups)
+{
+   return wakeups * IDLE_STAMP_ACCESSES * Sim_Access_Clocks * 100 / Sim_Sysclk();
+}
+
+// Call after Sim_Run with the firmware's Idle_Percent and Idle_Wakeups
+static inline void Idle_Report (long long firmware, long long wakeups)
+{
+   Report("idle_percent_last_s", Idle_Last_Percent());
+   Report("isr_percent_last_s", Isr_Last_Percent());
+   Report("firmware_idle_percent", firmware);
+   Report("firmware_idle_wakeups", wakeups);
+}
+
+static inline void Idle_Check (long long firmware, long long wakeups)
+{
+   Check("firmware_idle_percent",
+         firmware >= Idle_Last_Percent() - 2 &&
+         firmware <= Idle_Last_Percent() + Isr_Last_Percent() +
+                     Idle_Stamp_Percent(wakeups) + 2);
+}
+
+// Call before Sim_Run with the firmware's Ready_Ms
+static inline void Ready_Watch (const unsigned int *ready, Sim_Time when = 0)
+{
+   Sim_At(when, [ready, when] ()
+   {
+      if (*ready != 0xFFFF)
+      {
+         Scenario_Ready = Sim_Now();
+         return;
+      }
+
+      Ready_Watch(ready, when + 100 * SIM_US);
+   });
+}
+
+static inline void First_Tx (void)
+{
+   if (Scenario_First_Tx == 0)
+   {
+      Scenario_First_Tx = Sim_Now();
+   }
+}
+
+static inline void Boot_Report (unsigned int firmware)
+{
+   Report("ready_us", Scenario_Ready / SIM_US);
+   Report("firmware_ready_ms", firmware);
+   Report("first_tx_us", Scenario_First_Tx / SIM_US);
+}
+
+static inline void Boot_Check (unsigned int firmware, Sim_Time ready_max,
+                               Sim_Time first_tx_max)
+{
+   Check("ready_us", Scenario_Ready != 0 && Scenario_Ready <= ready_max);
+   Check("firmware_ready_ms", firmware <= Scenario_Ready / SIM_MS);
+   Check("first_tx_us", Scenario_First_Tx != 0 &&
+                        Scenario_First_Tx <= first_tx_max);
+}
+
+#endif                                 // SCENARIO_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,1261 @@
+//-----------------------------------------------------------------------------
+// sim.cpp
+//-----------------------------------------------------------------------------
+//
+// C8051F020 peripheral model for the host build. See sim.h for the overview.
+//
+// Peripherals are event driven. A running timer schedules an event for its
+// next overflow rather than counting on every access, and its count
+// register is brought up to date from the elapsed time only when the
+// firmware reads it or reconfigures the timer. Each reconfiguration bumps a
+// generation number so events scheduled under the old setup are ignored.
+//
+//-----------------------------------------------------------------------------
+
+#include "sim.h"
+
+#include <string.h>
+#include <deque>
+#include <queue>
+
+//-----------------------------------------------------------------------------
+// SFR addresses and bits used by the model
+//-----------------------------------------------------------------------------
+
+#define TCON      0x88
+#define PCON      0x87
+#define TH1       0x8D
+#define CKCON     0x8E
+#define TMR3CN    0x91
+#define TMR3RLL   0x92
+#define TMR3RLH   0x93
+#define TMR3L     0x94
+#define TMR3H     0x95
+#define ADC1      0x9C
+#define IE        0xA8
+#define ADC1CN    0xAA
+#define ADC1CF    0xAB
+#define AMX1SL    0xAC
+#define OSCXCN    0xB1
+#define OSCICN    0xB2
+#define IP        0xB8
+#define T2CON     0xC8
+#define T4CON     0xC9
+#define RCAP2L    0xCA
+#define RCAP2H    0xCB
+#define TMR2L     0xCC
+#define TMR2H     0xCD
+#define PCA0CN    0xD8
+#define PCA0MD    0xD9
+#define PCA0CPM0  0xDA
+#define EIE1      0xE6
+#define EIE2      0xE7
+#define RCAP4L    0xE4
+#define RCAP4H    0xE5
+#define PCA0L     0xE9
+#define PCA0CPL0  0xEA
+#define SCON1     0xF1
+#define SBUF1     0xF2
+#define EIP1      0xF6
+#define EIP2      0xF7
+#define TMR4L     0xF4
+#define TMR4H     0xF5
+#define PCA0H     0xF9
+#define PCA0CPH0  0xFA
+
+#define PCA_MODULES   5
+
+#define ISR_ENTRY_CLOCKS  12           // LCALL to the vector plus RETI
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+
+unsigned int Sim_Access_Clocks = 4;
+unsigned long Sim_Uart1_Line_Baud = 9600;
+
+namespace
+{
+
+struct Stop {};
+
+struct Event
+{
+   Sim_Time when;
+   unsigned long long order;
+   std::function<void (void)> fn;
+};
+
+struct Later
+{
+   bool operator() (const Event &a, const Event &b) const
+   {
+      return a.when != b.when ? a.when > b.when : a.order > b.order;
+   }
+};
+
+struct Timer16
+{
+   unsigned char control;              // control SFR
+   unsigned char run;                  // run bit in control
+   unsigned char flag;                 // overflow flag in control
+   unsigned char reload;               // reload low byte, high at +1
+   unsigned char count;                // counter low byte, high at +1
+   Sim_Time base;                      // time the count was last brought up to date
+   unsigned int prescale;              // SYSCLKs per count, 0 when stopped
+   unsigned int generation;
+};
+
+unsigned char Sfr[256];
+unsigned char Pins[256];
+std::vector<std::function<void (unsigned char, unsigned char)> > Hooks[256];
+
+Sim_Time Now = 0;
+Sim_Time End = ~(Sim_Time)0;
+unsigned long Sysclk = 2000000;
+Sim_Time Access_Ps = 0;
+
+std::priority_queue<Event, std::vector<Event>, Later> Events;
+unsigned long long Event_Order = 0;
+
+Sim_Isr Vectors[32];
+unsigned long Irq_Counts[32];
+int Irq_Level = -1;                    // -1 in main, 0 low, 1 high priority
+
+Sim_Time Idle_Ps = 0;
+Sim_Time Isr_Ps = 0;
+unsigned long long Access_Count = 0;
+
+Timer16 Timer2 = { T2CON, 0x04, 0x80, RCAP2L, TMR2L, 0, 0, 0 };
+Timer16 Timer3 = { TMR3CN, 0x04, 0x80, TMR3RLL, TMR3L, 0, 0, 0 };
+Timer16 Timer4 = { T4CON, 0x04, 0x80, RCAP4L, TMR4L, 0, 0, 0 };
+
+// PCA0
+Sim_Time Pca_Base = 0;
+unsigned int Pca_Prescale = 0;
+unsigned int Pca_Generation = 0;
+unsigned char Pca_High_Latch = 0;
+
+// UART1
+std::deque<unsigned char> Rx_Queue;
+bool Rx_Active = false;
+Sim_Time Rx_Line_Free = 0;
+Sim_Time Rx_Mark = 0;                  // time Rx_Bits was last brought up to date
+double Rx_Bits = 0;                    // bits the receiver has timed this byte
+unsigned char Rx_Data = 0;
+bool Tx_Busy = false;
+std::vector<unsigned char> Tx_Log;
+std::vector<std::function<void (unsigned char)> > Tx_Hooks;
+Sim_Uart_Stats Uart_Stats;
+
+// ADC1
+unsigned char Adc_Input[8];
+unsigned char Adc_Noise = 0;
+unsigned long Adc_Count = 0;
+bool Adc_Busy = false;
+unsigned long Noise_Seed = 1;
+
+// Oscillators
+unsigned long Crystal_Hz = 22118400;
+Sim_Time Crystal_Startup = 2 * SIM_MS;
+unsigned int Crystal_Generation = 0;
+unsigned long Clock_Switches = 0;
+unsigned long Xosc_Live_Writes = 0;
+
+//-----------------------------------------------------------------------------
+// Time
+//-----------------------------------------------------------------------------
+
+Sim_Time Clocks_To_Ps (unsigned long long clocks)
+{
+   return (Sim_Time)((unsigned __int128)clocks * SIM_S / Sysclk);
+}
+
+unsigned long long Ps_To_Clocks (Sim_Time ps)
+{
+   return (unsigned long long)((unsigned __int128)ps * Sysclk / SIM_S);
+}
+
+void Schedule (Sim_Time when, std::function<void (void)> fn)
+{
+   Event e = { when, Event_Order++, fn };
+   Events.push(e);
+}
+
+// Runs every event that is due. Each one sees Now set to its own time.
+void Run_Events (void)
+{
+   Sim_Time current = Now;
+
+   while (!Events.empty() && Events.top().when <= current)
+   {
+      Event e = Events.top();
+      Events.pop();
+
+      Now = e.when;
+      e.fn();
+   }
+
+   Now = current;
+}
+
+void Advance (Sim_Time ps)
+{
+   Now += ps;
+
+   if (!Events.empty() && Events.top().when <= Now)
+   {
+      Run_Events();
+   }
+
+   if (Now >= End)
+   {
+      throw Stop();
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Interrupts
+//-----------------------------------------------------------------------------
+
+bool Irq_Pending (int vector)
+{
+   int i;
+
+   switch (vector)
+   {
+   case 1:  return Sfr[TCON] & 0x20;                      // TF0
+   case 3:  return Sfr[TCON] & 0x80;                      // TF1
+   case 5:  return Sfr[T2CON] & 0x80;                     // TF2
+   case 9:
+      if ((Sfr[PCA0CN] & 0x80) && (Sfr[PCA0MD] & 0x01))   // CF and ECF
+      {
+         return true;
+      }
+      for (i = 0; i < PCA_MODULES; i++)                   // CCFn and ECCFn
+      {
+         if ((Sfr[PCA0CN] & (1 << i)) && (Sfr[PCA0CPM0 + i] & 0x01))
+         {
+            return true;
+         }
+      }
+      return false;
+   case 14: return Sfr[TMR3CN] & 0x80;                    // TF3
+   case 16: return Sfr[T4CON] & 0x80;                     // TF4
+   case 17: return Sfr[ADC1CN] & 0x20;                    // AD1INT
+   case 20: return Sfr[SCON1] & 0x03;                     // RI1, TI1
+   default: return false;
+   }
+}
+
+bool Irq_Bit (int vector, unsigned char low, unsigned char mid, unsigned char high)
+{
+   if (vector <= 5)
+   {
+      return Sfr[low] & (1 << vector);
+   }
+   if (vector <= 13)
+   {
+      return Sfr[mid] & (1 << (vector - 6));
+   }
+   return Sfr[high] & (1 << (vector - 14));
+}
+
+// Highest-priority interrupt that may run now, or -1
+int Irq_Next (int *level)
+{
+   int vector;
+   int best = -1;
+   int bestLevel = -1;
+   int priority;
+
+   if (!(Sfr[IE] & 0x80))
+   {
+      return -1;
+   }
+
+   for (vector = 0; vector < 32; vector++)
+   {
+      if (Vectors[vector] == 0 || !Irq_Bit(vector, IE, EIE1, EIE2) ||
+          !Irq_Pending(vector))
+      {
+         continue;
+      }
+
+      priority = Irq_Bit(vector, IP, EIP1, EIP2) ? 1 : 0;
+
+      if (priority > Irq_Level && priority > bestLevel)
+      {
+         best = vector;
+         bestLevel = priority;
+      }
+   }
+
+   *level = bestLevel;
+   return best;
+}
+
+void Dispatch (void)
+{
+   int vector;
+   int level;
+   int saved;
+   Sim_Time start;
+
+   while ((vector = Irq_Next(&level)) >= 0)
+   {
+      saved = Irq_Level;
+      Irq_Level = level;
+      Irq_Counts[vector]++;
+      start = Now;
+
+      Advance(Clocks_To_Ps(ISR_ENTRY_CLOCKS));
+      Vectors[vector]();
+
+      Irq_Level = saved;
+
+      if (saved < 0)
+      {
+         Isr_Ps += Now - start;                  // outermost only, once
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Timer2, Timer3 and Timer4
+//-----------------------------------------------------------------------------
+
+void Adc_Trigger (unsigned char source);
+
+unsigned int Timer_Count (const Timer16 &t)
+{
+   return Sfr[t.count] | (Sfr[t.count + 1] << 8);
+}
+
+void Timer_Set_Count (Timer16 &t, unsigned int count)
+{
+   Sfr[t.count] = (unsigned char)count;
+   Sfr[t.count + 1] = (unsigned char)(count >> 8);
+}
+
+void Timer_Sync (Timer16 &t)
+{
+   unsigned long long ticks;
+   unsigned int count = Timer_Count(t);
+
+   if (t.prescale == 0)
+   {
+      t.base = Now;
+      return;
+   }
+
+   ticks = Ps_To_Clocks(Now - t.base) / t.prescale;
+
+   // The overflow itself is handled by its event
+   if (ticks >= 0x10000UL - count)
+   {
+      ticks = 0xFFFFUL - count;
+   }
+
+   Timer_Set_Count(t, count + (unsigned int)ticks);
+   t.base += Clocks_To_Ps(ticks * t.prescale);
+}
+
+void Timer_Overflow (Timer16 &t, unsigned int generation);
+
+void Timer_Schedule (Timer16 &t)
+{
+   unsigned int generation = ++t.generation;
+   Timer16 *timer = &t;
+
+   if (t.prescale == 0)
+   {
+      return;
+   }
+
+   Schedule(t.base + Clocks_To_Ps((0x10000ULL - Timer_Count(t)) * t.prescale),
+            [timer, generation] () { Timer_Overflow(*timer, generation); });
+}
+
+void Timer_Overflow (Timer16 &t, unsigned int generation)
+{
+   if (generation != t.generation)
+   {
+      return;
+   }
+
+   Timer_Set_Count(t, Sfr[t.reload] | (Sfr[t.reload + 1] << 8));
+   t.base = Now;
+   Sfr[t.control] |= t.flag;
+
+   if (&t == &Timer3)
+   {
+      Adc_Trigger(1);
+   }
+   else if (&t == &Timer2)
+   {
+      Adc_Trigger(3);
+   }
+
+   Timer_Schedule(t);
+}
+
+// Works out the prescaler from the control bits and restarts the schedule
+void Timer_Configure (Timer16 &t)
+{
+   unsigned int prescale = 0;
+
+   if (Sfr[t.control] & t.run)
+   {
+      if (&t == &Timer2)
+      {
+         prescale = (Sfr[CKCON] & 0x20) ? 1 : 12;
+      }
+      else if (&t == &Timer4)
+      {
+         prescale = (Sfr[CKCON] & 0x40) ? 1 : 12;
+      }
+      else
+      {
+         prescale = (Sfr[TMR3CN] & 0x02) ? 1 : 12;
+      }
+   }
+
+   // Keep the partial count when only the flag or the reload changed
+   if (prescale != t.prescale)
+   {
+      t.prescale = prescale;
+      t.base = Now;
+   }
+
+   Timer_Schedule(t);
+}
+
+//-----------------------------------------------------------------------------
+// PCA0
+//-----------------------------------------------------------------------------
+
+unsigned int Pca_Count (void)
+{
+   return Sfr[PCA0L] | (Sfr[PCA0H] << 8);
+}
+
+void Pca_Sync (void)
+{
+   unsigned long long ticks;
+
+   if (Pca_Prescale == 0)
+   {
+      Pca_Base = Now;
+      return;
+   }
+
+   ticks = Ps_To_Clocks(Now - Pca_Base) / Pca_Prescale;
+
+   // Matches and the overflow are handled by their event
+   if (ticks > 0)
+   {
+      unsigned int count = Pca_Count() + (unsigned int)ticks;
+      Sfr[PCA0L] = (unsigned char)count;
+      Sfr[PCA0H] = (unsigned char)(count >> 8);
+      Pca_Base += Clocks_To_Ps(ticks * Pca_Prescale);
+   }
+}
+
+void Pca_Schedule (void);
+
+void Pca_Event (unsigned int generation, unsigned int target)
+{
+   int i;
+   unsigned int compare;
+
+   if (generation != Pca_Generation)
+   {
+      return;
+   }
+
+   target &= 0xFFFF;
+   Sfr[PCA0L] = (unsigned char)target;
+   Sfr[PCA0H] = (unsigned char)(target >> 8);
+   Pca_Base = Now;
+
+   if (target == 0)
+   {
+      Sfr[PCA0CN] |= 0x80;               // CF
+   }
+
+   for (i = 0; i < PCA_MODULES; i++)
+   {
+      compare = Sfr[PCA0CPL0 + i] | (Sfr[PCA0CPH0 + i] << 8);
+
+      if ((Sfr[PCA0CPM0 + i] & 0x48) == 0x48 && compare == target)
+      {
+         Sfr[PCA0CN] |= 1 << i;          // CCFn
+      }
+   }
+
+   Pca_Schedule();
+}
+
+// Schedules the next count at which a match or the overflow happens
+void Pca_Schedule (void)
+{
+   int i;
+   unsigned int generation = ++Pca_Generation;
+   unsigned int count = Pca_Count();
+   unsigned long distance = 0x10000UL - count;
+   unsigned long d;
+   unsigned int compare;
+
+   if (Pca_Prescale == 0)
+   {
+      return;
+   }
+
+   for (i = 0; i < PCA_MODULES; i++)
+   {
+      if ((Sfr[PCA0CPM0 + i] & 0x48) != 0x48)
+      {
+         continue;
+      }
+
+      compare = Sfr[PCA0CPL0 + i] | (Sfr[PCA0CPH0 + i] << 8);
+      d = (compare - count) & 0xFFFF;
+
+      if (d == 0)
+      {
+         d = 0x10000UL;
+      }
+
+      if (d < distance)
+      {
+         distance = d;
+      }
+   }
+
+   Schedule(Pca_Base + Clocks_To_Ps((unsigned long long)distance * Pca_Prescale),
+            [generation, count, distance] ()
+            {
+               Pca_Event(generation, count + distance);
+            });
+}
+
+void Pca_Configure (void)
+{
+   static const unsigned char divide[8] = { 12, 4, 12, 12, 1, 8, 12, 12 };
+   unsigned int prescale;
+
+   prescale = (Sfr[PCA0CN] & 0x40) ? divide[(Sfr[PCA0MD] >> 1) & 7] : 0;
+
+   if (prescale != Pca_Prescale)
+   {
+      Pca_Prescale = prescale;
+      Pca_Base = Now;
+   }
+
+   Pca_Schedule();
+}
+
+//-----------------------------------------------------------------------------
+// ADC1
+//-----------------------------------------------------------------------------
+
+void Adc_Complete (unsigned char channel)
+{
+   int value = Adc_Input[channel];
+
+   if (Adc_Noise != 0)
+   {
+      Noise_Seed = Noise_Seed * 1103515245UL + 12345UL;
+      value += (int)((Noise_Seed >> 16) % (2 * Adc_Noise + 1)) - Adc_Noise;
+
+      if (value < 0) value = 0;
+      if (value > 255) value = 255;
+   }
+
+   Adc_Busy = false;
+   Adc_Count++;
+
+   Sfr[ADC1] = (unsigned char)value;
+   Sfr[ADC1CN] = (Sfr[ADC1CN] & ~0x10) | 0x20;   // clear AD1BUSY, set AD1INT
+}
+
+// <source> is the AD1CM start-of-conversion mode that fired
+void Adc_Trigger (unsigned char source)
+{
+   unsigned char channel = Sfr[AMX1SL] & 0x07;
+   unsigned int sarClocks = (Sfr[ADC1CF] >> 3) + 1;
+
+   if (!(Sfr[ADC1CN] & 0x80) || ((Sfr[ADC1CN] >> 1) & 0x07) != source ||
+       Adc_Busy)
+   {
+      return;
+   }
+
+   Adc_Busy = true;
+   Sfr[ADC1CN] |= 0x10;
+
+   // Tracking plus 8 bit decisions, roughly 10 SAR clocks
+   Schedule(Now + Clocks_To_Ps(sarClocks * 10),
+            [channel] () { Adc_Complete(channel); });
+}
+
+//-----------------------------------------------------------------------------
+// UART1
+//-----------------------------------------------------------------------------
+
+unsigned long long Uart_Bit_Clocks (void)
+{
+   unsigned long long clocks = 256 - Sfr[TH1];
+
+   clocks *= (Sfr[CKCON] & 0x10) ? 1 : 12;       // T1M
+   clocks *= (Sfr[PCON] & 0x10) ? 16 : 32;       // SMOD1
+
+   return clocks;
+}
+
+// Adds the bits the receiver has timed off Timer1 since Rx_Mark, at the
+// baud rate set up until now; none while Timer1 is stopped. Called before
+// anything that can change the rate, so a byte that spans a change is timed
+// in pieces.
+void Rx_Accrue (void)
+{
+   if (!Rx_Active || Now <= Rx_Mark)
+   {
+      return;
+   }
+
+   if (Sfr[TCON] & 0x40)                         // TR1
+   {
+      Rx_Bits += (double)(Now - Rx_Mark) * Sim_Uart1_Baud() / SIM_S;
+   }
+
+   Rx_Mark = Now;
+}
+
+void Rx_Start (void);
+
+void Rx_Complete (void)
+{
+   unsigned char value = Rx_Queue.front();
+   double error;
+
+   Rx_Accrue();
+
+   Rx_Queue.pop_front();
+   Rx_Active = false;
+   Rx_Line_Free = Now;
+
+   if (Sfr[SCON1] & 0x10)                        // REN1
+   {
+      // The byte is 10 bits on the line; the receiver gets it wrong once
+      // its own timing of them is off by more than 3%
+      error = Rx_Bits > 10 ? Rx_Bits - 10 : 10 - Rx_Bits;
+
+      if (error > 10 * 0.03)
+      {
+         Uart_Stats.rx_framing_errors++;
+      }
+      else if (Sfr[SCON1] & 0x01)
+      {
+         Uart_Stats.rx_overruns++;
+      }
+      else
+      {
+         Rx_Data = value;
+         Sfr[SCON1] |= 0x01;                     // RI1
+         Uart_Stats.rx_bytes++;
+      }
+   }
+
+   Rx_Start();
+}
+
+void Rx_Start (void)
+{
+   Sim_Time start;
+
+   if (Rx_Active || Rx_Queue.empty())
+   {
+      return;
+   }
+
+   start = Now > Rx_Line_Free ? Now : Rx_Line_Free;
+   Rx_Active = true;
+   Rx_Mark = start;
+   Rx_Bits = 0;
+
+   Schedule(start + 10 * SIM_S / Sim_Uart1_Line_Baud, Rx_Complete);
+}
+
+void Tx_Start (unsigned char value)
+{
+   if (Tx_Busy)
+   {
+      Uart_Stats.tx_collisions++;
+      return;
+   }
+
+   Tx_Busy = true;
+
+   Schedule(Now + Clocks_To_Ps(10 * Uart_Bit_Clocks()), [value] ()
+   {
+      size_t i;
+
+      Tx_Busy = false;
+      Tx_Log.push_back(value);
+      Uart_Stats.tx_bytes++;
+      Sfr[SCON1] |= 0x02;                        // TI1
+
+      for (i = 0; i < Tx_Hooks.size(); i++)
+      {
+         Tx_Hooks[i](value);
+      }
+   });
+}
+
+//-----------------------------------------------------------------------------
+// Clock
+//-----------------------------------------------------------------------------
+
+void Clock_Update (void)
+{
+   static const unsigned long internal[4] = { 2000000, 4000000, 8000000, 16000000 };
+   unsigned long hz;
+
+   if (Sfr[OSCICN] & 0x08)                       // CLKSL: external
+   {
+      hz = ((Sfr[OSCXCN] & 0x70) == 0x70) ? Crystal_Hz / 2 : Crystal_Hz;
+   }
+   else
+   {
+      hz = internal[Sfr[OSCICN] & 0x03];
+   }
+
+   if (hz == Sysclk)
+   {
+      return;
+   }
+
+   // Bring every counter up to date on the old clock before switching
+   Timer_Sync(Timer2);
+   Timer_Sync(Timer3);
+   Timer_Sync(Timer4);
+   Pca_Sync();
+
+   Sysclk = hz;
+   if (Sfr[OSCICN] & 0x08)                       // hops to the internal
+   {                                             // osc. are not counted
+      Clock_Switches++;
+   }
+   Access_Ps = Clocks_To_Ps(Sim_Access_Clocks);
+   Timer2.base = Timer3.base = Timer4.base = Pca_Base = Now;
+
+   Timer_Configure(Timer2);
+   Timer_Configure(Timer3);
+   Timer_Configure(Timer4);
+   Pca_Configure();
+}
+
+void Crystal_Start (void)
+{
+   unsigned int generation = ++Crystal_Generation;
+
+   Sfr[OSCXCN] &= ~0x80;                         // XTLVLD
+
+   if ((Sfr[OSCXCN] & 0x60) != 0x60)             // not a crystal mode
+   {
+      return;
+   }
+
+   Schedule(Now + Crystal_Startup, [generation] ()
+   {
+      if (generation == Crystal_Generation)
+      {
+         Sfr[OSCXCN] |= 0x80;
+      }
+   });
+}
+
+//-----------------------------------------------------------------------------
+// PCON
+//-----------------------------------------------------------------------------
+
+void Idle (void)
+{
+   Sim_Time start = Now;
+   int level;
+
+   while (Irq_Next(&level) < 0)
+   {
+      if (Events.empty() || Events.top().when >= End)
+      {
+         Idle_Ps += End - start;
+         Now = End;
+         throw Stop();                           // nothing left to wake it
+      }
+
+      if (Events.top().when > Now)
+      {
+         Now = Events.top().when;
+      }
+
+      Run_Events();
+   }
+
+   Idle_Ps += Now - start;
+   Sfr[PCON] &= ~0x01;
+}
+
+//-----------------------------------------------------------------------------
+// SFR side effects
+//-----------------------------------------------------------------------------
+
+bool Is_Port (unsigned char addr)
+{
+   return addr == SIM_P0 || addr == SIM_P1 || addr == SIM_P2 ||
+          addr == SIM_P3 || addr == SIM_P4 || addr == SIM_P5 ||
+          addr == SIM_P6 || addr == SIM_P7;
+}
+
+unsigned char Read_Effect (unsigned char addr)
+{
+   if (Is_Port(addr))
+   {
+      return Sfr[addr] & Pins[addr];
+   }
+
+   switch (addr)
+   {
+   case SBUF1:
+      return Rx_Data;
+
+   case TMR2L: case TMR2H:
+      Timer_Sync(Timer2);
+      break;
+
+   case TMR3L: case TMR3H:
+      Timer_Sync(Timer3);
+      break;
+
+   case TMR4L: case TMR4H:
+      Timer_Sync(Timer4);
+      break;
+
+   case PCA0L:
+      Pca_Sync();
+      Pca_High_Latch = Sfr[PCA0H];
+      break;
+
+   case PCA0H:
+      return Pca_High_Latch;
+   }
+
+   return Sfr[addr];
+}
+
+void Write_Effect (unsigned char addr, unsigned char value)
+{
+   unsigned char before = Sfr[addr];
+   int module;
+
+   switch (addr)
+   {
+   case SBUF1:
+      Tx_Start(value);
+      return;
+
+   case T2CON: case RCAP2L: case RCAP2H: case TMR2L: case TMR2H:
+      Timer_Sync(Timer2);
+      Sfr[addr] = value;
+      Timer_Configure(Timer2);
+      return;
+
+   case TMR3CN: case TMR3RLL: case TMR3RLH: case TMR3L: case TMR3H:
+      Timer_Sync(Timer3);
+      Sfr[addr] = value;
+      Timer_Configure(Timer3);
+      return;
+
+   case T4CON: case RCAP4L: case RCAP4H: case TMR4L: case TMR4H:
+      Timer_Sync(Timer4);
+      Sfr[addr] = value;
+      Timer_Configure(Timer4);
+      return;
+
+   case CKCON:
+      Timer_Sync(Timer2);
+      Timer_Sync(Timer4);
+      Sfr[addr] = value;
+      Timer_Configure(Timer2);
+      Timer_Configure(Timer4);
+      return;
+
+   case ADC1CN:
+      // AD1BUSY is owned by the converter; writing 1 starts a conversion
+      Sfr[addr] = (value & ~0x10) | (before & 0x10);
+      if (value & 0x10)
+      {
+         Adc_Trigger(0);
+      }
+      return;
+
+   case OSCXCN:
+      Sfr[addr] = (value & ~0x80) | (before & 0x80);
+
+      // XOSCMD may only change while the crystal is not SYSCLK
+      if ((Sfr[OSCICN] & 0x08) && ((before ^ value) & 0x70))
+      {
+         Xosc_Live_Writes++;
+      }
+
+      // Switching the divide-by-2 in or out leaves the crystal running
+      if ((before & 0x60) != 0x60 || (value & 0x60) != 0x60)
+      {
+         Crystal_Start();
+      }
+
+      Clock_Update();
+      return;
+
+   case OSCICN:
+      // IFRDY follows IOSCEN; the oscillator is taken as ready at once
+      Sfr[addr] = (value & ~0x10) | ((value & 0x04) ? 0x10 : 0);
+      Clock_Update();
+      return;
+
+   case PCON:
+      Sfr[addr] = value;
+      if (value & 0x02)
+      {
+         throw Stop();                           // STOP mode never wakes here
+      }
+      if (value & 0x01)
+      {
+         Idle();
+      }
+      return;
+
+   case PCA0CN: case PCA0MD: case PCA0L: case PCA0H:
+      Pca_Sync();
+      Sfr[addr] = value;
+      Pca_Configure();
+      return;
+   }
+
+   if (addr >= PCA0CPM0 && addr < PCA0CPM0 + PCA_MODULES)
+   {
+      Pca_Sync();
+      Sfr[addr] = value;
+      Pca_Schedule();
+      return;
+   }
+
+   // Writing PCA0CPLn clears ECOMn and writing PCA0CPHn sets it
+   if (addr >= PCA0CPL0 && addr < PCA0CPL0 + PCA_MODULES)
+   {
+      module = addr - PCA0CPL0;
+      Pca_Sync();
+      Sfr[addr] = value;
+      Sfr[PCA0CPM0 + module] &= ~0x40;
+      Pca_Schedule();
+      return;
+   }
+
+   if (addr >= PCA0CPH0 && addr < PCA0CPH0 + PCA_MODULES)
+   {
+      module = addr - PCA0CPH0;
+      Pca_Sync();
+      Sfr[addr] = value;
+      Sfr[PCA0CPM0 + module] |= 0x40;
+      Pca_Schedule();
+      return;
+   }
+
+   Sfr[addr] = value;
+}
+
+void Write (unsigned char addr, unsigned char value)
+{
+   unsigned char before = Sfr[addr];
+   size_t i;
+
+   Advance(Access_Ps);
+   Access_Count++;
+
+   switch (addr)
+   {
+   case TCON: case TH1: case CKCON: case PCON: case OSCXCN: case OSCICN:
+      Rx_Accrue();                               // may change the baud rate
+      break;
+   }
+
+   Write_Effect(addr, value);
+
+   for (i = 0; i < Hooks[addr].size(); i++)
+   {
+      Hooks[addr][i](before, Sfr[addr]);
+   }
+
+   Dispatch();
+}
+
+}                                      // namespace
+
+//-----------------------------------------------------------------------------
+// SFR access
+//-----------------------------------------------------------------------------
+
+unsigned char Sim_Read (unsigned char addr)
+{
+   unsigned char value;
+
+   Advance(Access_Ps);
+   Access_Count++;
+
+   value = Read_Effect(addr);
+
+   Dispatch();
+
+   return value;
+}
+
+void Sim_Write (unsigned char addr, unsigned char value)
+{
+   Write(addr, value);
+}
+
+unsigned char Sim_Read_Bit (unsigned char addr, unsigned char bit)
+{
+   return (Sim_Read(addr) >> bit) & 1;
+}
+
+void Sim_Write_Bit (unsigned char addr, unsigned char bit, unsigned char value)
+{
+   unsigned char mask = 1 << bit;
+
+   Write(addr, value ? (Sfr[addr] | mask) : (Sfr[addr] & ~mask));
+}
+
+unsigned char Sim_Latch (unsigned char addr)
+{
+   return Sfr[addr];
+}
+
+Sim_Vector::Sim_Vector (unsigned char vector, Sim_Isr isr)
+{
+   Vectors[vector & 31] = isr;
+}
+
+void Sim_Nop (void)
+{
+   Advance(Clocks_To_Ps(1));
+}
+
+//-----------------------------------------------------------------------------
+// Running
+//-----------------------------------------------------------------------------
+
+void Sim_Init (void)
+{
+   memset(Sfr, 0, sizeof(Sfr));
+   memset(Pins, 0xFF, sizeof(Pins));
+
+   Sfr[SIM_P0] = Sfr[SIM_P1] = Sfr[SIM_P2] = Sfr[SIM_P3] = 0xFF;
+   Sfr[SIM_P4] = Sfr[SIM_P5] = Sfr[SIM_P6] = Sfr[SIM_P7] = 0xFF;
+   Sfr[0x81] = 0x07;                             // SP
+   Sfr[OSCICN] = 0x14;                           // 2 MHz internal, ready
+
+   Now = 0;
+   End = ~(Sim_Time)0;
+   Sysclk = 2000000;
+   Access_Ps = Clocks_To_Ps(Sim_Access_Clocks);
+
+   while (!Events.empty())
+   {
+      Events.pop();
+   }
+
+   Timer2.prescale = Timer3.prescale = Timer4.prescale = 0;
+   Pca_Prescale = 0;
+   Rx_Queue.clear();
+   Rx_Active = Tx_Busy = Adc_Busy = false;
+   Tx_Log.clear();
+   memset(&Uart_Stats, 0, sizeof(Uart_Stats));
+   memset(Irq_Counts, 0, sizeof(Irq_Counts));
+   Idle_Ps = Isr_Ps = 0;
+   Access_Count = 0;
+   Clock_Switches = 0;
+   Xosc_Live_Writes = 0;
+}
+
+void Sim_Run (void (*firmware) (void), Sim_Time duration)
+{
+   End = Now + duration;
+   Access_Ps = Clocks_To_Ps(Sim_Access_Clocks);
+
+   try
+   {
+      firmware();
+   }
+   catch (Stop &)
+   {
+   }
+
+   Irq_Level = -1;
+   End = ~(Sim_Time)0;
+}
+
+Sim_Time Sim_Now (void)
+{
+   return Now;
+}
+
+unsigned long Sim_Sysclk (void)
+{
+   return Sysclk;
+}
+
+unsigned long Sim_Clock_Switches (void)
+{
+   return Clock_Switches;
+}
+
+unsigned long Sim_Xosc_Live_Writes (void)
+{
+   return Xosc_Live_Writes;
+}
+
+void Sim_At (Sim_Time when, std::function<void (void)> fn)
+{
+   Schedule(when, fn);
+}
+
+void Sim_After (Sim_Time delay, std::function<void (void)> fn)
+{
+   Schedule(Now + delay, fn);
+}
+
+void Sim_On_Write (unsigned char addr,
+                   std::function<void (unsigned char before, unsigned char after)> fn)
+{
+   Hooks[addr].push_back(fn);
+}
+
+void Sim_Drive_Pins (unsigned char port, unsigned char mask, unsigned char level)
+{
+   Pins[port] = (Pins[port] & ~mask) | (level & mask);
+}
+
+//-----------------------------------------------------------------------------
+// UART1
+//-----------------------------------------------------------------------------
+
+void Sim_Uart1_Inject (const unsigned char *data, size_t length)
+{
+   Rx_Queue.insert(Rx_Queue.end(), data, data + length);
+   Rx_Start();
+}
+
+void Sim_Uart1_Inject (const std::vector<unsigned char> &data)
+{
+   Sim_Uart1_Inject(data.data(), data.size());
+}
+
+const std::vector<unsigned char> &Sim_Uart1_Tx (void)
+{
+   return Tx_Log;
+}
+
+void Sim_Uart1_On_Tx (std::function<void (unsigned char)> fn)
+{
+   Tx_Hooks.push_back(fn);
+}
+
+unsigned long Sim_Uart1_Baud (void)
+{
+   return Sysclk / Uart_Bit_Clocks();
+}
+
+const Sim_Uart_Stats &Sim_Uart1_Stats (void)
+{
+   return Uart_Stats;
+}
+
+//-----------------------------------------------------------------------------
+// ADC1
+//-----------------------------------------------------------------------------
+
+void Sim_Adc1_Input (unsigned char channel, unsigned char code)
+{
+   Adc_Input[channel & 7] = code;
+}
+
+void Sim_Adc1_Noise (unsigned char lsb)
+{
+   Adc_Noise = lsb;
+}
+
+unsigned long Sim_Adc1_Conversions (void)
+{
+   return Adc_Count;
+}
+
+//-----------------------------------------------------------------------------
+// PCA0
+//-----------------------------------------------------------------------------
+
+void Sim_Pca_Edge (unsigned char module, bool rising)
+{
+   unsigned char mode = Sfr[PCA0CPM0 + module];
+
+   if (!(mode & (rising ? 0x20 : 0x10)))         // CAPPn / CAPNn
+   {
+      return;
+   }
+
+   Pca_Sync();
+   Sfr[PCA0CPL0 + module] = Sfr[PCA0L];
+   Sfr[PCA0CPH0 + module] = Sfr[PCA0H];
+   Sfr[PCA0CN] |= 1 << module;
+}
+
+bool Sim_Pca_Cex_Low (unsigned char module)
+{
+   unsigned char mode = Sfr[PCA0CPM0 + module];
+
+   return (mode & 0x02) && !(mode & 0x40);
+}
+
+//-----------------------------------------------------------------------------
+// Statistics
+//-----------------------------------------------------------------------------
+
+Sim_Time Sim_Idle_Time (void)
+{
+   return Idle_Ps;
+}
+
+unsigned long Sim_Interrupts (unsigned char vector)
+{
+   return Irq_Counts[vector & 31];
+}
+
+Sim_Time Sim_Isr_Time (void)
+{
+   return Isr_Ps;
+}
+
+bool Sim_In_Interrupt (void)
+{
+   return Irq_Level >= 0;
+}
+
+unsigned long long Sim_Accesses (void)
+{
+   return Access_Count;
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
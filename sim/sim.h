@@ -0,0 +1,255 @@
+//-----------------------------------------------------------------------------
+// sim.h
+//-----------------------------------------------------------------------------
+//
+// Host model of the parts of the C8051F020 that the two firmware images use,
+// so they can be built with gcc or clang and run on Linux unmodified.
+//
+// The firmware is compiled as C++ against sim/include/compiler_defs.h, which
+// turns every SFR and SBIT declared in C8051F020_defs.h into a small proxy
+// object. Each read or write of a proxy goes through Sim_Read / Sim_Write,
+// which
+//
+//    1) advances simulated time by Sim_Access_Clocks SYSCLK cycles and runs
+//       any peripheral or scenario events that have come due,
+//    2) applies the side effects of the access (SBUF1 starts a transmit,
+//       reading PCA0L latches PCA0H, setting IDLE waits for an interrupt...),
+//    3) calls the ISR of every enabled, pending interrupt, highest priority
+//       first, with low-priority ISRs preemptible by high-priority ones as
+//       on the chip.
+//
+// Firmware code that does not touch an SFR takes no simulated time, so this
+// is a functional model and not a cycle count; see `make bench` for that.
+//
+// Modelled: UART1 (with Timer1 baud rate), Timer2-4, ADC1, PCA0,
+// the oscillators and SYSCLK switching, PCON idle, and the port latches and
+// pins of P0-P7. Everything else reads back what was written.
+//
+// Time is kept in picoseconds, so scenario events and external devices keep
+// their real-time behaviour when the firmware changes SYSCLK.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Time
+//-----------------------------------------------------------------------------
+
+typedef uint64_t Sim_Time;
+
+#define SIM_NS   1000ULL
+#define SIM_US   1000000ULL
+#define SIM_MS   1000000000ULL
+#define SIM_S    1000000000000ULL
+
+// SFR addresses of the port latches
+#define SIM_P0   0x80
+#define SIM_P1   0x90
+#define SIM_P2   0xA0
+#define SIM_P3   0xB0
+#define SIM_P4   0x84
+#define SIM_P5   0x85
+#define SIM_P6   0x86
+#define SIM_P7   0x96
+
+//-----------------------------------------------------------------------------
+// SFR access, used by the proxies below
+//-----------------------------------------------------------------------------
+
+unsigned char Sim_Read (unsigned char addr);
+void Sim_Write (unsigned char addr, unsigned char value);
+unsigned char Sim_Read_Bit (unsigned char addr, unsigned char bit);
+void Sim_Write_Bit (unsigned char addr, unsigned char bit, unsigned char value);
+unsigned char Sim_Latch (unsigned char addr);  // no side effects, no time
+
+class Sim_Sfr
+{
+public:
+   constexpr explicit Sim_Sfr (unsigned char addr) : addr_(addr) {}
+
+   operator unsigned char () const { return Sim_Read(addr_); }
+
+   Sim_Sfr &operator= (unsigned char v) { Sim_Write(addr_, v); return *this; }
+   Sim_Sfr &operator= (const Sim_Sfr &o) { return *this = (unsigned char)o; }
+
+   // Read-modify-write instructions (ANL, ORL, XRL, INC...) act on the latch
+   // in a single access, so the ISR can never run in the middle of one
+   Sim_Sfr &operator|= (int v) { return rmw(Sim_Latch(addr_) | v); }
+   Sim_Sfr &operator&= (int v) { return rmw(Sim_Latch(addr_) & v); }
+   Sim_Sfr &operator^= (int v) { return rmw(Sim_Latch(addr_) ^ v); }
+   Sim_Sfr &operator+= (int v) { return rmw(Sim_Latch(addr_) + v); }
+   Sim_Sfr &operator-= (int v) { return rmw(Sim_Latch(addr_) - v); }
+   Sim_Sfr &operator<<= (int v) { return rmw(Sim_Latch(addr_) << v); }
+   Sim_Sfr &operator>>= (int v) { return rmw(Sim_Latch(addr_) >> v); }
+   Sim_Sfr &operator++ () { return rmw(Sim_Latch(addr_) + 1); }
+   Sim_Sfr &operator-- () { return rmw(Sim_Latch(addr_) - 1); }
+   unsigned char operator++ (int) { unsigned char v = Sim_Latch(addr_); rmw(v + 1); return v; }
+   unsigned char operator-- (int) { unsigned char v = Sim_Latch(addr_); rmw(v - 1); return v; }
+
+private:
+   Sim_Sfr &rmw (int v) { Sim_Write(addr_, (unsigned char)v); return *this; }
+   unsigned char addr_;
+};
+
+// Two consecutive SFRs, low byte first, as declared with SFR16
+class Sim_Sfr16
+{
+public:
+   constexpr explicit Sim_Sfr16 (unsigned char addr) : addr_(addr) {}
+
+   operator unsigned int () const
+   {
+      unsigned int lo = Sim_Read(addr_);
+      return lo | ((unsigned int)Sim_Read(addr_ + 1) << 8);
+   }
+
+   Sim_Sfr16 &operator= (unsigned int v)
+   {
+      Sim_Write(addr_, (unsigned char)v);
+      Sim_Write(addr_ + 1, (unsigned char)(v >> 8));
+      return *this;
+   }
+   Sim_Sfr16 &operator= (const Sim_Sfr16 &o) { return *this = (unsigned int)o; }
+
+   Sim_Sfr16 &operator|= (unsigned int v) { return *this = (unsigned int)*this | v; }
+   Sim_Sfr16 &operator&= (unsigned int v) { return *this = (unsigned int)*this & v; }
+   Sim_Sfr16 &operator+= (unsigned int v) { return *this = (unsigned int)*this + v; }
+   Sim_Sfr16 &operator-= (unsigned int v) { return *this = (unsigned int)*this - v; }
+
+private:
+   unsigned char addr_;
+};
+
+class Sim_Bit
+{
+public:
+   constexpr Sim_Bit (unsigned char addr, unsigned char bit)
+      : addr_(addr), bit_(bit) {}
+
+   operator unsigned char () const { return Sim_Read_Bit(addr_, bit_); }
+
+   Sim_Bit &operator= (unsigned char v) { Sim_Write_Bit(addr_, bit_, v); return *this; }
+   Sim_Bit &operator= (const Sim_Bit &o) { return *this = (unsigned char)o; }
+
+private:
+   unsigned char addr_;
+   unsigned char bit_;
+};
+
+// Registers an ISR under its interrupt number
+typedef void (*Sim_Isr) (void);
+
+class Sim_Vector
+{
+public:
+   Sim_Vector (unsigned char vector, Sim_Isr isr);
+};
+
+void Sim_Nop (void);
+
+//-----------------------------------------------------------------------------
+// Running
+//-----------------------------------------------------------------------------
+
+// SYSCLK cycles charged for each SFR access, standing in for the
+// instructions around it. Higher is faster to simulate, lower is finer.
+extern unsigned int Sim_Access_Clocks;
+
+void Sim_Init (void);
+
+// Runs <firmware> (the firmware's main, renamed) until <duration> of
+// simulated time has passed, then returns. The firmware is abandoned where
+// it is, so a scenario runs once per process.
+void Sim_Run (void (*firmware) (void), Sim_Time duration);
+
+Sim_Time Sim_Now (void);
+unsigned long Sim_Sysclk (void);
+unsigned long Sim_Clock_Switches (void);   // SYSCLK changes since Sim_Init
+                                           // onto the crystal
+unsigned long Sim_Xosc_Live_Writes (void); // XOSCMD changes made while the
+                                           // crystal was SYSCLK
+
+// Scenario and device events, run between SFR accesses
+void Sim_At (Sim_Time when, std::function<void (void)> fn);
+void Sim_After (Sim_Time delay, std::function<void (void)> fn);
+
+// Called after every write to <addr>, with the latch before and after
+void Sim_On_Write (unsigned char addr,
+                   std::function<void (unsigned char before, unsigned char after)> fn);
+
+//-----------------------------------------------------------------------------
+// Pins
+//-----------------------------------------------------------------------------
+
+// External devices pull pins low; reading a port returns latch AND pins
+void Sim_Drive_Pins (unsigned char port, unsigned char mask, unsigned char level);
+
+//-----------------------------------------------------------------------------
+// UART1
+//-----------------------------------------------------------------------------
+
+// Queues bytes from the radio. They are delivered at Sim_Uart1_Line_Baud,
+// back to back after whatever is already queued.
+void Sim_Uart1_Inject (const unsigned char *data, size_t length);
+void Sim_Uart1_Inject (const std::vector<unsigned char> &data);
+
+// Every byte the firmware has sent
+const std::vector<unsigned char> &Sim_Uart1_Tx (void);
+void Sim_Uart1_On_Tx (std::function<void (unsigned char)> fn);
+
+// Baud rate the firmware has set up on Timer1, in bits per second
+unsigned long Sim_Uart1_Baud (void);
+
+extern unsigned long Sim_Uart1_Line_Baud; // baud rate of the radio
+
+struct Sim_Uart_Stats
+{
+   unsigned long rx_bytes;             // delivered to SBUF1
+   unsigned long rx_overruns;          // arrived while RI1 was still set
+   unsigned long rx_framing_errors;    // byte timed more than 3% off the line
+   unsigned long tx_bytes;
+   unsigned long tx_collisions;        // SBUF1 written while still sending
+};
+
+const Sim_Uart_Stats &Sim_Uart1_Stats (void);
+
+//-----------------------------------------------------------------------------
+// ADC1
+//-----------------------------------------------------------------------------
+
+void Sim_Adc1_Input (unsigned char channel, unsigned char code);
+void Sim_Adc1_Noise (unsigned char lsb); // +/- uniform noise on each sample
+unsigned long Sim_Adc1_Conversions (void);
+
+//-----------------------------------------------------------------------------
+// PCA0
+//-----------------------------------------------------------------------------
+
+// An edge on CEXn, captured if module n is set up for it
+void Sim_Pca_Edge (unsigned char module, bool rising);
+
+// True while module n holds CEXn low (8-bit PWM with ECOM clear)
+bool Sim_Pca_Cex_Low (unsigned char module);
+
+//-----------------------------------------------------------------------------
+// Statistics
+//-----------------------------------------------------------------------------
+
+Sim_Time Sim_Idle_Time (void);         // time spent with PCON.IDLE set
+Sim_Time Sim_Isr_Time (void);          // time spent in interrupt handlers
+unsigned long Sim_Interrupts (unsigned char vector);
+bool Sim_In_Interrupt (void);          // true while an ISR is running
+unsigned long long Sim_Accesses (void);
+
+#endif                                 // SIM_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
@@ -0,0 +1,445 @@
+//-----------------------------------------------------------------------------
+// thermostat_sim.cpp
+//-----------------------------------------------------------------------------
+//
+// Runs the thermostat firmware against simulated hardware:
+//
+//    - a TMP36 on ADC1 channel 6 and the set-point dial on channel 1, both
+//      with a few LSB of noise,
+//    - the control unit sending the average temp and its state over the
+//      radio,
+//    - a 2x16 HD44780 LCD on P1 (RS, EN, R/W) and P2 (D0-D7),
+//    - the status LEDs on P5.
+//
+// At the end it prints what the firmware did, including the LCD contents,
+// and checks it against what the inputs should have produced.
+//
+// Usage: thermostat-sim [--seconds N]
+//
+//-----------------------------------------------------------------------------
+
+#include <compiler_defs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "config.h"
+#include "clock.h"
+#include "radio.h"
+#include "scenario.h"
+#include "xbee.h"
+
+//-----------------------------------------------------------------------------
+// Firmware symbols
+//-----------------------------------------------------------------------------
+
+void Firmware_Main (void);
+
+extern unsigned char UART_Rx_Overflows;
+extern unsigned char Dial_Reading;
+extern unsigned char Temp_Reading;
+extern volatile unsigned char Lcd_Queue_Done;
+extern unsigned char Idle_Percent;
+extern unsigned int Idle_Wakeups;
+extern unsigned int Ready_Ms;
+
+//-----------------------------------------------------------------------------
+// HD44780 in 8-bit mode
+//-----------------------------------------------------------------------------
+//
+// Latches RS and D0-D7 on the falling edge of EN. Only what the firmware
+// uses is modelled: clear, return home, entry mode, set DDRAM address and
+// data writes, with the address counter wrapping as on the real part.
+//
+// Each instruction keeps the controller busy for its typical execution
+// time, and so does its internal reset for LCD_POWER_ON after power on. A
+// write that arrives while it is busy is dropped, as the real part would,
+// and counted. With R/W high, EN high puts the busy flag on D7 and the
+// address counter on D0-D6, and any of P2 not left floating high by the
+// MCU counts as bus contention.
+// Data writes made outside an interrupt are counted too, since once the
+// firmware is up the display should only be written from its queue.
+//
+//-----------------------------------------------------------------------------
+
+#define LCD_RS  0x01                   // P1.0
+#define LCD_EN  0x04                   // P1.2
+#define LCD_RW  0x08                   // P1.3
+
+#define LCD_P2MDOUT  0xA6
+
+#define LCD_EXEC     (37 * SIM_US)
+#define LCD_CLEAR    (1520 * SIM_US)
+#define LCD_POWER_ON (15 * SIM_MS)      // the datasheet's wait, Vcc at 4.5 V
+
+static struct
+{
+   unsigned char ddram[128];
+   unsigned char address;
+   bool increment;
+   Sim_Time busy_until;
+   unsigned long commands;
+   unsigned long data;
+   unsigned long busy_writes;          // dropped, the controller was busy
+   unsigned long main_data;            // data writes outside an interrupt
+   unsigned long busy_reads;
+   unsigned long early_reads;          // before the reset sequence was sent
+   unsigned long contention;           // D7 driven by both sides
+   Sim_Time last_write;
+   Sim_Time burst_total;               // first to last write of each redraw
+   unsigned long bursts;
+   Sim_Time gap_max;                   // longest gap inside a redraw,
+                                       // after the timed reset sequence
+} Lcd;
+
+static void Lcd_Clear (void)
+{
+   memset(Lcd.ddram, ' ', sizeof(Lcd.ddram));
+   Lcd.address = 0;
+}
+
+static void Lcd_Step (void)
+{
+   if (Lcd.increment)
+   {
+      Lcd.address = Lcd.address == 0x27 ? 0x40 :
+                    Lcd.address == 0x67 ? 0x00 : Lcd.address + 1;
+   }
+   else
+   {
+      Lcd.address = Lcd.address == 0x40 ? 0x27 :
+                    Lcd.address == 0x00 ? 0x67 : Lcd.address - 1;
+   }
+}
+
+static void Lcd_Bus (unsigned char before, unsigned char after)
+{
+   unsigned char value = Sim_Latch(SIM_P2);
+   Sim_Time now = Sim_Now();
+
+   if (after & LCD_RW)
+   {
+      if (!(before & LCD_EN) && (after & LCD_EN))
+      {
+         // Busy flag and address counter out on D0-D7; only D7 is read.
+         // Any line the MCU still drives, push-pull or held low, fights it.
+         Lcd.busy_reads++;
+         if (Lcd.commands < 4)
+         {
+            Lcd.early_reads++;
+         }
+         if (Sim_Latch(LCD_P2MDOUT) || Sim_Latch(SIM_P2) != 0xFF)
+         {
+            Lcd.contention++;
+         }
+         Sim_Drive_Pins(SIM_P2, 0xFF, (now < Lcd.busy_until ? 0x80 : 0x00) |
+                                      (Lcd.address & 0x7F));
+      }
+      else if ((before & LCD_EN) && !(after & LCD_EN))
+      {
+         Sim_Drive_Pins(SIM_P2, 0xFF, 0xFF);
+      }
+      return;
+   }
+
+   if (!(before & LCD_EN) || (after & LCD_EN))
+   {
+      return;                                    // not a falling edge of EN
+   }
+
+   if (now < Lcd.busy_until)
+   {
+      Lcd.busy_writes++;
+      return;
+   }
+
+   // Writes less than 1 ms apart belong to the same redraw
+   if (now - Lcd.last_write > SIM_MS)
+   {
+      Lcd.bursts++;
+   }
+   else
+   {
+      Lcd.burst_total += now - Lcd.last_write;
+      if (now - Lcd.last_write > Lcd.gap_max && Lcd.commands >= 4)
+      {
+         Lcd.gap_max = now - Lcd.last_write;
+      }
+   }
+   Lcd.last_write = now;
+   Lcd.busy_until = now + LCD_EXEC;
+
+   if (after & LCD_RS)
+   {
+      Lcd.ddram[Lcd.address & 0x7F] = value;
+      Lcd.data++;
+      if (!Sim_In_Interrupt())
+      {
+         Lcd.main_data++;
+      }
+      Lcd_Step();
+      return;
+   }
+
+   Lcd.commands++;
+
+   if (value <= 0x03 && value != 0)
+   {
+      Lcd.busy_until = now + LCD_CLEAR;
+   }
+
+   if (value & 0x80)
+   {
+      Lcd.address = value & 0x7F;
+   }
+   else if (value & 0x40)
+   {
+      // CGRAM address, unused
+   }
+   else if ((value & 0xFC) == 0x04)
+   {
+      Lcd.increment = value & 0x02;
+   }
+   else if (value & 0x02)
+   {
+      Lcd.address = 0;
+   }
+   else if (value & 0x01)
+   {
+      Lcd_Clear();
+   }
+}
+
+static std::string Lcd_Line (int line)
+{
+   return std::string((const char *)Lcd.ddram + (line == 1 ? 0x00 : 0x40), 16);
+}
+
+//-----------------------------------------------------------------------------
+// Radio
+//-----------------------------------------------------------------------------
+
+static Radio_Decoder Tx_Decoder(XBEE_AP == 2);
+static Radio_Tx_Request Last_Tx;
+static unsigned long Tx_Frames = 0;
+
+static void Tx_Byte (unsigned char b)
+{
+   Radio_Tx_Request request;
+
+   First_Tx();
+
+   if (Tx_Decoder.Feed(b) && Tx_Decoder.Tx_Request(&request))
+   {
+      Last_Tx = request;
+      Tx_Frames++;
+   }
+}
+
+//-----------------------------------------------------------------------------
+// Readings
+//-----------------------------------------------------------------------------
+//
+// The converted readings, looked at every 10 ms once the firmware has
+// settled, to see how much of the ADC noise gets through the firmware's
+// averaging.
+//
+//-----------------------------------------------------------------------------
+
+#define ADC1CN_ADDR  0xAA
+#define AMX1SL_ADDR  0xAC
+
+static unsigned long Mux_Busy_Writes = 0;
+
+// AMX1SL changed while ADC1 was converting, so the firmware cannot know
+// which input that result came from
+static void Mux_Write (unsigned char before, unsigned char after)
+{
+   if (before != after && (Sim_Latch(ADC1CN_ADDR) & 0x10))
+   {
+      Mux_Busy_Writes++;
+   }
+}
+
+static struct
+{
+   int temp_min, temp_max;
+   int dial_min, dial_max;
+} Readings = { 255, 0, 255, 0 };
+
+static void Readings_Watch (Sim_Time when)
+{
+   Sim_At(when, [when] ()
+   {
+      if (Temp_Reading < Readings.temp_min) Readings.temp_min = Temp_Reading;
+      if (Temp_Reading > Readings.temp_max) Readings.temp_max = Temp_Reading;
+      if (Dial_Reading < Readings.dial_min) Readings.dial_min = Dial_Reading;
+      if (Dial_Reading > Readings.dial_max) Readings.dial_max = Dial_Reading;
+
+      Readings_Watch(when + 10 * SIM_MS);
+   });
+}
+
+static void Control_Unit_Send (Sim_Time when)
+{
+   Sim_At(when, [when] ()
+   {
+      Radio_Bytes payload;
+
+      payload.push_back(74);                     // average temp
+      payload.push_back(0x01);                   // unit on, coolant left
+      Sim_Uart1_Inject(Radio_Rx_Packet(0x0013A20040A1B2A0ULL, 0x0000, payload,
+                                       XBEE_AP == 2));
+
+      Control_Unit_Send(when + 2 * SIM_S);
+   });
+}
+
+//-----------------------------------------------------------------------------
+// main
+//-----------------------------------------------------------------------------
+
+int main (int argc, char **argv)
+{
+   unsigned int seconds = 20;
+   const Sim_Uart_Stats *uart;
+   std::string line1;
+   std::string line2;
+   int i;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+      {
+         seconds = atoi(argv[++i]);
+      }
+      else
+      {
+         fprintf(stderr, "usage: %s [--seconds N]\n", argv[0]);
+         return 2;
+      }
+   }
+
+   Sim_Init();
+   uart = &Sim_Uart1_Stats();
+
+   Lcd_Clear();
+   Lcd.increment = true;
+   Lcd.busy_until = LCD_POWER_ON;
+
+   // TMP36 at 75 F and the dial at 70 F, per the firmware's conversions.
+   // One LSB of noise is 2 F on a single sample of the TMP36; averaged,
+   // the temp may still flicker by 1 F, as 75.2 F sits close to the 75/74
+   // boundary.
+   Sim_Adc1_Input(6, 115);
+   Sim_Adc1_Input(1, 128);
+   Sim_Adc1_Noise(1);
+
+   Sim_On_Write(SIM_P1, Lcd_Bus);
+   Sim_Uart1_On_Tx(Tx_Byte);
+   Control_Unit_Send(500 * SIM_MS);
+   Readings_Watch(2 * SIM_S);
+   Sim_On_Write(AMX1SL_ADDR, Mux_Write);
+
+   Idle_Mark(seconds * SIM_S);
+   Ready_Watch(&Ready_Ms);
+   Sim_Run(Firmware_Main, seconds * SIM_S);
+
+   line1 = Lcd_Line(1);
+   line2 = Lcd_Line(2);
+
+   Report("sim_seconds", seconds);
+   Report("sysclk_hz", Sim_Sysclk());
+   Report("sysclk_switches", Sim_Clock_Switches());
+   Report("xosc_live_writes", Sim_Xosc_Live_Writes());
+   Report("uart1_baud", Sim_Uart1_Baud());
+   Report("uart1_rx_bytes", uart->rx_bytes);
+   Report("uart1_rx_overruns", uart->rx_overruns);
+   Report("uart1_rx_framing_errors", uart->rx_framing_errors);
+   Report("uart1_tx_bytes", uart->tx_bytes);
+   Report("uart1_tx_collisions", uart->tx_collisions);
+   Report("rx_ring_overflows", UART_Rx_Overflows);
+   Report("xbee_checksum_errors", XBee_Checksum_Errors);
+   Report("tx_frames", Tx_Frames);
+   Report("tx_bytes_per_frame", Tx_Frames ? uart->tx_bytes / Tx_Frames : 0);
+   Report("tx_stray_bytes", Tx_Decoder.skipped);
+   Report("adc1_conversions", Sim_Adc1_Conversions());
+   Report("temp_reading", Temp_Reading);
+   Report("dial_reading", Dial_Reading);
+   Report("adc1_mux_busy_writes", Mux_Busy_Writes);
+   Report("temp_reading_spread", Readings.temp_max - Readings.temp_min);
+   Report("dial_reading_spread", Readings.dial_max - Readings.dial_min);
+   Report("lcd_commands", Lcd.commands);
+   Report("lcd_data_writes", Lcd.data);
+   Report("lcd_busy_writes", Lcd.busy_writes);
+   Report("lcd_main_data_writes", Lcd.main_data);
+   Report("lcd_queue_done", Lcd_Queue_Done);
+   Report("lcd_busy_reads", Lcd.busy_reads);
+   Report("lcd_bus_contention", Lcd.contention);
+   Report("lcd_redraw_us", Lcd.bursts ? Lcd.burst_total / Lcd.bursts / SIM_US : 0);
+   Report("lcd_gap_max_us", Lcd.gap_max / SIM_US);
+   Report("leds", Sim_Latch(SIM_P5) & 0xF0);
+   Report("interrupts_timer2", Sim_Interrupts(5));
+   Report("interrupts_timer3", Sim_Interrupts(14));
+   Report("interrupts_adc1", Sim_Interrupts(17));
+   Report("interrupts_timer4", Sim_Interrupts(16));
+   Report("interrupts_uart1", Sim_Interrupts(20));
+   Report("idle_ms", Sim_Idle_Time() / SIM_MS);
+   Boot_Report(Ready_Ms);
+   Idle_Report(Idle_Percent, Idle_Wakeups);
+   printf("lcd_line1                    \"%s\"\n", line1.c_str());
+   printf("lcd_line2                    \"%s\"\n", line2.c_str());
+
+   Check_Equal("uart1_rx_overruns", uart->rx_overruns, 0);
+   // Nothing here needs full speed once the redraw is integer maths, so
+   // the clock drops to half at start-up and stays there; the control
+   // unit's scenario switches with bytes on the line. The tick must keep
+   // to 1 ms within 0.1% (less the start-up).
+   Check_Equal("uart1_framing_errors", uart->rx_framing_errors, 0);
+   Check_Equal("sysclk_hz", Sim_Sysclk(), SYSCLK / 2);
+   Check_Equal("xosc_live_writes", Sim_Xosc_Live_Writes(), 0);
+   Check("tick_rate", Sim_Interrupts(5) >= seconds * 999 - 50 &&
+                      Sim_Interrupts(5) <= seconds * 1001);
+   Check_Equal("rx_ring_overflows", UART_Rx_Overflows, 0);
+   Check_Equal("xbee_checksum_errors", XBee_Checksum_Errors, 0);
+   Check_Equal("temp_reading", Temp_Reading, 75);
+   Check_Equal("dial_reading", Dial_Reading, 70);
+   Check_Equal("adc1_mux_busy_writes", Mux_Busy_Writes, 0);
+   // One 512-sample burst per 150 ms redraw, not 50,000 samples a second
+   Check("interrupts_adc1", Sim_Interrupts(17) < seconds * 4000);
+   Check("temp_reading_spread", Readings.temp_max - Readings.temp_min <= 1);
+   Check_Equal("dial_reading_spread", Readings.dial_max - Readings.dial_min, 0);
+   Check_Equal("lcd_busy_writes", Lcd.busy_writes, 0);
+   // The three 0x30s of the reset sequence and the function set are timed;
+   // the busy flag means nothing until they are in
+   Check_Equal("lcd_early_busy_reads", Lcd.early_reads, 0);
+   // One write per Timer4 overflow, 50 us, at either clock speed
+   Check("lcd_gap_max", Lcd.gap_max < 75 * SIM_US);
+   // Init, the first full screen, then only the cells that change: the
+   // average and state once the first frame is in. Redrawing everything
+   // every 150 ms would be some 170 a second.
+   Check("lcd_transactions", Lcd.commands + Lcd.data < 60);
+   Check_Equal("lcd_bus_contention", Lcd.contention, 0);
+   Check_Equal("lcd_main_data_writes", Lcd.main_data, 0);
+   Check_Equal("lcd_queue_done", Lcd_Queue_Done, 1);
+   Check("lcd_line1_temp", line1.find("Temp: 74") != std::string::npos);
+   Check("lcd_line1_state", line1.find("ON") != std::string::npos);
+   Check("lcd_line2_set", line2.find("Set:  70") != std::string::npos);
+   Check_Equal("leds", Sim_Latch(SIM_P5) & 0x30, 0x30);
+   Check("tx_frames", Tx_Frames >= seconds * 1000 / 1800 - 1);
+   Check_Equal("tx_bytes_per_frame", Tx_Frames ? uart->tx_bytes / Tx_Frames : 0, 20);
+   Check_Equal("tx_stray_bytes", Tx_Decoder.skipped, 0);
+   Check_Equal("tx_addr16", Last_Tx.addr16, 0xFFFE);
+   Check_Equal("tx_set_point", Last_Tx.payload.size() == 2 ? Last_Tx.payload[0] : -1, 70);
+   Check_Equal("tx_temp", Last_Tx.payload.size() == 2 ? Last_Tx.payload[1] : -1, 75);
+   // Up once the crystal has started, and transmitting with the first
+   // readings, 10 ms later; the LED self-test and LCD init run alongside
+   Boot_Check(Ready_Ms, 5 * SIM_MS, 20 * SIM_MS);
+   Idle_Check(Idle_Percent, Idle_Wakeups);
+
+   return Scenario_Failures;
+}
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
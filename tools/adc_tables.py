@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# adc_tables.py
+#-----------------------------------------------------------------------------
+#
+# Writes 8051-thermostat/adc_tables.h, the code-memory tables the thermostat
+# converts its ADC1 readings with. Used by `make adc-tables`; the generated
+# header is checked in, so a build needs neither Python nor this script.
+#
+# Both tables have an entry for every 8-bit ADC1 code:
+#
+#    Temp_Table   room temp in 1/16 F, clamped to 0-255 F. The TMP36 moves
+#                 about 1.8 F per code, so the firmware interpolates between
+#                 neighbouring entries with the 4 extra bits that
+#                 oversampling gives it.
+#    Dial_Table   set point in whole F. The dial moves about 0.16 F per
+#                 code, so the nearest entry is close enough.
+#
+# Calibration:
+#
+#    --temp-zero   ADC1 code of the TMP36 at 0 C (32 F)
+#    --temp-step   F per ADC1 code
+#    --dial-min    set point with the dial at one end (code 0)
+#    --dial-max    set point at the other (code 255); the top half degree
+#                  rounds up to it, so the whole range can be dialled in
+#
+# Usage: adc_tables.py [calibration] --out FILE
+#
+#-----------------------------------------------------------------------------
+
+import argparse
+import sys
+
+CODES = 256
+
+
+def temp_table(zero, step):
+    """Returns the room temp in 1/16 F for each code."""
+    table = []
+    for code in range(CODES):
+        sixteenths = int(round(((code - zero) * step + 32.0) * 16))
+        table.append(min(max(sixteenths, 0), 255 * 16))
+    return table
+
+
+def dial_table(low, high):
+    """Returns the set point in whole F for each code."""
+    table = []
+    for code in range(CODES):
+        setpoint = low + code * (high - low) / (CODES - 1.0)
+        if setpoint > high - 0.5:
+            setpoint = high
+        table.append(int(setpoint))
+    return table
+
+
+def c_array(decl, values, width):
+    """Formats <values> as a C initialiser, 8 to a line."""
+    lines = []
+    for i in range(0, len(values), 8):
+        row = ", ".join("%*d" % (width, v) for v in values[i:i + 8])
+        lines.append("   %s%s   // %3d" % (row, "," if i + 8 < len(values) else " ", i))
+    return "%s =\n{\n%s\n};\n" % (decl, "\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--temp-zero", type=float, default=91.0)
+    parser.add_argument("--temp-step", type=float, default=1.8)
+    parser.add_argument("--dial-min", type=float, default=50.0)
+    parser.add_argument("--dial-max", type=float, default=90.0)
+    parser.add_argument("--out", required=True)
+    args = parser.parse_args()
+
+    if args.temp_step <= 0:
+        sys.exit("adc_tables: --temp-step must be positive")
+    if not 0 <= args.dial_min < args.dial_max <= 255:
+        sys.exit("adc_tables: need 0 <= --dial-min < --dial-max <= 255")
+
+    text = """\
+//-----------------------------------------------------------------------------
+// adc_tables.h
+//-----------------------------------------------------------------------------
+//
+// Generated by tools/adc_tables.py; do not edit. Change the calibration and
+// run `make adc-tables` instead.
+//
+// Calibration:
+//    TMP36  code %g at 32 F, %g F per code
+//    dial   %g F at code 0 to %g F at code 255
+//
+// Included once, by main.c.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef ADC_TABLES_H
+#define ADC_TABLES_H
+
+// Room temp in 1/16 F for each ADC1 code
+%s
+// Set point in F for each ADC1 code
+%s
+#endif                                 // ADC_TABLES_H
+
+//-----------------------------------------------------------------------------
+// End Of File
+//-----------------------------------------------------------------------------
+""" % (args.temp_zero, args.temp_step, args.dial_min, args.dial_max,
+       c_array("static unsigned int SEG_CODE Temp_Table[256]",
+               temp_table(args.temp_zero, args.temp_step), 4),
+       c_array("static unsigned char SEG_CODE Dial_Table[256]",
+               dial_table(args.dial_min, args.dial_max), 2))
+
+    with open(args.out, "w") as out:
+        out.write(text)
+
+    print("wrote %s" % args.out)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# compare.py
+#-----------------------------------------------------------------------------
+#
+# Builds two revisions of the firmware with SDCC and prints their memory use
+# and the control unit's machine-cycle counts side by side. Used by
+# `make compare`.
+#
+# Each revision is checked out into a git worktree under --out. Early
+# revisions have no Makefile, so every image is built the same way here:
+# its main source and each .c file, in the image directory or common/,
+# whose header one of the sources already taken includes. For the current
+# tree that is AC_SRC, and TH_SRC plus sched.c, as #ifdef is not followed
+# and uart.c includes sched.h for the control unit.
+#
+# Sizes come from tools/size_report.py, run without budgets. Cycles come
+# from bench/bench_temp.c, which calls only functions every revision of the
+# control unit has had. It is linked against the revision's own sources,
+# with BENCH_FLOAT defined for revisions that still keep the coolant temp
+# in a float, and run under ucsim by bench/ucsim_bench.py. bench_ac.c and
+# bench_th.c follow the current sources and are not used here.
+#
+# Usage: compare.py [--sdcc sdcc] [--s51 s51] --out DIR BASE REV
+#
+#-----------------------------------------------------------------------------
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+IMAGES = (
+    ("control-unit", "8051-air-conditioner", "control-unit.c"),
+    ("thermostat", "8051-thermostat", "main.c"),
+)
+
+SDCC_CFLAGS = ["-mmcs51", "--model-small"]
+SDCC_LDFLAGS = ["--code-size", "65024", "--xram-size", "4096",
+                "--iram-size", "256"]
+
+INCLUDE = re.compile(r'^\s*#\s*include\s+"(\w+)\.h"', re.M)
+SIZE_LINE = re.compile(r"^\s+(CODE|DATA|IDATA|XDATA|STACK)\s+(\d+) bytes", re.M)
+FLOAT_TEMP = re.compile(r"^\s*float\s+internal_temp\b", re.M)
+
+
+def run(command, cwd=None):
+    """Runs <command>, stopping with its output if it fails."""
+    try:
+        proc = subprocess.run(command, cwd=cwd, stdout=subprocess.PIPE,
+                              stderr=subprocess.STDOUT,
+                              universal_newlines=True)
+    except FileNotFoundError:
+        sys.exit("compare: %s not found; install SDCC (ucsim ships with it) "
+                 "or set SDCC= and S51=" % command[0])
+
+    if proc.returncode != 0:
+        sys.stdout.write(proc.stdout)
+        sys.exit("compare: %s failed" % " ".join(command))
+
+    return proc.stdout
+
+
+def checkout(rev, out):
+    """Checks <rev> out into a fresh worktree and returns its path."""
+    path = os.path.join(out, "src-" + rev.replace("/", "_"))
+
+    if os.path.exists(path):
+        run(["git", "worktree", "remove", "--force", path], cwd=ROOT)
+
+    run(["git", "worktree", "add", "--detach", path, rev], cwd=ROOT)
+
+    return path
+
+
+def sources(tree, image_dir, main):
+    """Returns the image's sources, main first, as paths within <tree>."""
+    dirs = [image_dir, "common"]
+    found = [os.path.join(image_dir, main)]
+    i = 0
+
+    while i < len(found):
+        text = open(os.path.join(tree, found[i])).read()
+        i += 1
+
+        for name in INCLUDE.findall(text):
+            for d in dirs:
+                path = os.path.join(d, name + ".c")
+                if path not in found and os.path.exists(os.path.join(tree, path)):
+                    found.append(path)
+                    break
+
+    return found
+
+
+def build(sdcc, out, name, srcs, includes):
+    """Compiles and links <srcs>, (path, defines) pairs with main's module
+    first, and returns the .ihx path and the .asm files."""
+    os.makedirs(out, exist_ok=True)
+    rels = []
+
+    for src, defines in srcs:
+        rel = os.path.join(out, os.path.splitext(os.path.basename(src))[0] + ".rel")
+        run([sdcc] + SDCC_CFLAGS + includes + defines + ["-c", src, "-o", rel])
+        rels.append(rel)
+
+    ihx = os.path.join(out, name + ".ihx")
+    run([sdcc] + SDCC_CFLAGS + SDCC_LDFLAGS + ["-o", ihx] + rels)
+
+    return ihx, [os.path.splitext(r)[0] + ".asm" for r in rels]
+
+
+def measure(rev, sdcc, s51, out):
+    """Returns {"sizes": {image: {...}}, "cycles": {...}} for <rev>."""
+    tree = checkout(rev, out)
+    build_out = os.path.join(out, rev.replace("/", "_"))
+    result = {"sizes": {}, "cycles": {}}
+
+    try:
+        for name, image_dir, main in IMAGES:
+            includes = ["-I" + os.path.join(tree, image_dir),
+                        "-I" + os.path.join(tree, "common")]
+            srcs = sources(tree, image_dir, main)
+
+            ihx, asm = build(sdcc, os.path.join(build_out, name), name,
+                             [(os.path.join(tree, s), []) for s in srcs],
+                             includes)
+            report = run([sys.executable,
+                          os.path.join(ROOT, "tools", "size_report.py"),
+                          "--name", name, "--mem", ihx[:-4] + ".mem"] + asm)
+            result["sizes"][name] = dict((k.lower(), int(v)) for k, v in
+                                         SIZE_LINE.findall(report))
+
+            if name != "control-unit":
+                continue
+
+            # The benchmark driver, from this tree, takes main's place
+            driver = []
+            if FLOAT_TEMP.search(open(os.path.join(tree, srcs[0])).read()):
+                driver.append("-DBENCH_FLOAT")
+
+            bench_out = os.path.join(build_out, "bench")
+            ihx, _ = build(sdcc, bench_out, "bench",
+                           [(os.path.join(ROOT, "bench", "bench_temp.c"), driver),
+                            (os.path.join(ROOT, "bench", "bench.c"), [])] +
+                           [(os.path.join(tree, s), ["-Dmain=Firmware_Main"])
+                            for s in srcs],
+                           includes + ["-I" + os.path.join(ROOT, "bench")])
+
+            results = os.path.join(bench_out, "results.json")
+            run([sys.executable, os.path.join(ROOT, "bench", "ucsim_bench.py"),
+                 "--s51", s51, "--out", results, name + "=" + ihx])
+            with open(results) as f:
+                result["cycles"] = json.load(f)["images"][name]
+    finally:
+        run(["git", "worktree", "remove", "--force", tree], cwd=ROOT)
+
+    return result
+
+
+def delta(old, new):
+    if old:
+        return "%+7d (%+.1f%%)" % (new - old, 100.0 * (new - old) / old)
+    return "%+7d" % (new - old)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--sdcc", default="sdcc")
+    parser.add_argument("--s51", default="s51")
+    parser.add_argument("--out", required=True)
+    parser.add_argument("base")
+    parser.add_argument("rev")
+    args = parser.parse_args()
+
+    out = os.path.abspath(args.out)
+    os.makedirs(out, exist_ok=True)
+
+    base = measure(args.base, args.sdcc, args.s51, out)
+    rev = measure(args.rev, args.sdcc, args.s51, out)
+
+    print("%s -> %s" % (args.base, args.rev))
+
+    for name, _, _ in IMAGES:
+        print("%s, bytes:" % name)
+        for key in ("code", "data", "idata", "xdata", "stack"):
+            old = base["sizes"][name].get(key, 0)
+            new = rev["sizes"][name].get(key, 0)
+            print("  %-6s %6d -> %6d  %s" % (key.upper(), old, new, delta(old, new)))
+
+    print("control-unit, mean machine cycles:")
+    for function in sorted(rev["cycles"]):
+        old = base["cycles"].get(function, {}).get("mean", 0)
+        new = rev["cycles"][function]["mean"]
+        print("  %-14s %8d -> %8d  %s" % (function, old, new, delta(old, new)))
+
+    with open(os.path.join(out, "compare.json"), "w") as f:
+        json.dump({"base": args.base, "rev": args.rev, args.base: base,
+                   args.rev: rev}, f, indent=2, sort_keys=True)
+        f.write("\n")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
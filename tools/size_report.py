@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# size_report.py
+#-----------------------------------------------------------------------------
+#
+# Memory report for one SDCC image, checked against budgets. Used by
+# `make firmware`.
+#
+# Code and XDATA come from the linker's .mem file, as do DATA and IDATA,
+# which are counted cell by cell from its internal RAM map:
+#
+#    DATA   register banks, bit registers, data, overlay and absolute
+#           variables, all in the directly addressed 0x00-0x7F
+#    IDATA  idata variables, which may also sit in 0x80-0xFF
+#
+# Worst-case stack comes from the call graph in the compiler's .asm output.
+# Each function's depth is the most it pushes at any point plus, for every
+# call it makes, the 2-byte return address and the callee's own depth.
+# Calls through a function pointer are charged with the deepest function
+# whose address is taken anywhere in the image. Calls into the SDCC library
+# (integer and float helpers), which have no .asm here, are charged
+# --lib-stack bytes each. An interrupt adds its return address to the
+# deepest handler, and with two priority levels a high-priority handler can
+# interrupt a low-priority one, so the two deepest handlers are added on
+# top of main's depth.
+#
+# The stack is also checked against what the linker left free above the
+# variables, whatever the budget.
+#
+# A .mem file without the internal RAM map or the ROM line is an error, so
+# a linker whose output differs from SDCC's stops the build instead of
+# reporting an empty image that fits every budget.
+#
+# Usage: size_report.py --name NAME --mem IMAGE.mem [budgets] FILE.asm ...
+#
+#-----------------------------------------------------------------------------
+
+import argparse
+import re
+import sys
+
+DATA_CELLS = set("0123TBQA") | set("abcdefghijklmnopqrstuvwxyz")
+
+FUNCTION = re.compile(r"^(_\w+):\s*$")
+AREA = re.compile(r"^\s*\.area\s+(\w+)")
+CALL = re.compile(r"^\s*[la]call\s+(\w+)")
+JUMP = re.compile(r"^\s*[las]jmp\s+(_\w+)\s*$")
+ADDRESS_OF = re.compile(r"#\(?(_\w+)\b")
+PUSH = re.compile(r"^\s*push\s")
+POP = re.compile(r"^\s*pop\s")
+RETI = re.compile(r"^\s*reti\b")
+
+INDIRECT = "__sdcc_call_dptr"
+
+
+def read_mem(path):
+    """Returns (code, xdata, data, idata, stack_free) from a .mem file."""
+    text = open(path).read()
+
+    data = 0
+    idata = 0
+    rows = 0
+
+    for match in re.finditer(r"^0x([0-9a-fA-F]{2}):\|(.*)\|\s*$", text, re.M):
+        rows += 1
+        base = int(match.group(1), 16)
+        for offset, cell in enumerate(match.group(2).split("|")):
+            cell = cell.strip()
+            if cell == "I":
+                idata += 1
+            elif cell in DATA_CELLS and cell:
+                if base + offset < 0x80:
+                    data += 1
+                else:
+                    idata += 1
+
+    if rows == 0:
+        sys.exit("size_report: no internal RAM map in %s" % path)
+
+    def other(name, required=False):
+        match = re.search(r"^\s*%s\s+(?:0x\w+\s+0x\w+\s+)?(\d+)\s+\d+" %
+                          re.escape(name), text, re.M)
+        if not match and required:
+            sys.exit("size_report: no %s line in %s" % (name, path))
+        return int(match.group(1)) if match else 0
+
+    code = other("ROM/EPROM/FLASH", True)
+    xdata = other("EXTERNAL RAM") + other("PAGED EXT. RAM")
+
+    match = re.search(r"Stack starts at: \S+ \(sp set to \S+\) with (\d+) bytes available", text)
+    stack_free = int(match.group(1)) if match else None
+
+    return code, xdata, data, idata, stack_free
+
+
+def read_asm(paths):
+    """Returns the functions in the .asm files as {name: info}."""
+    functions = {}
+    address_taken = set()
+
+    for path in paths:
+        current = None
+        in_code = False
+
+        for line in open(path):
+            line = line.split(";", 1)[0].rstrip()
+
+            match = AREA.match(line)
+            if match:
+                in_code = match.group(1) == "CSEG"
+                current = None
+                continue
+
+            for name in ADDRESS_OF.findall(line):
+                address_taken.add(name)
+
+            match = FUNCTION.match(line)
+            if match and in_code:
+                current = {"pushes": 0, "peak": 0, "calls": [], "isr": False}
+                functions[match.group(1)] = current
+                continue
+
+            if current is None:
+                continue
+
+            if PUSH.match(line):
+                current["pushes"] += 1
+                current["peak"] = max(current["peak"], current["pushes"])
+            elif POP.match(line):
+                current["pushes"] = max(current["pushes"] - 1, 0)
+            elif RETI.match(line):
+                current["isr"] = True
+            else:
+                match = CALL.match(line) or JUMP.match(line)
+                if match:
+                    tail = not CALL.match(line)
+                    current["calls"].append((match.group(1), current["pushes"], tail))
+
+    return functions, address_taken & set(functions)
+
+
+def stack_depths(functions, address_taken, lib_stack):
+    """Returns {name: worst bytes of stack used by a call of it}."""
+    depths = {}
+    unknown = set()
+
+    def depth(name, path):
+        if name in depths:
+            return depths[name]
+        if name in path:
+            sys.exit("size_report: recursion through %s; stack depth is "
+                     "unbounded" % " -> ".join(path + [name]))
+
+        info = functions[name]
+        worst = info["peak"]
+
+        for callee, pushed, tail in info["calls"]:
+            if callee == INDIRECT:
+                targets = [depth(t, path + [name]) for t in address_taken]
+                callee_depth = max(targets) if targets else 0
+                # __sdcc_call_dptr pushes the target before jumping to it
+                callee_depth = max(callee_depth, 2)
+            elif callee in functions:
+                if tail and callee == name:
+                    continue
+                callee_depth = depth(callee, path + [name])
+            elif callee.startswith("_") and not tail:
+                unknown.add(callee)
+                callee_depth = lib_stack
+            else:
+                continue
+
+            worst = max(worst, pushed + (0 if tail else 2) + callee_depth)
+
+        depths[name] = worst
+        return worst
+
+    for name in functions:
+        depth(name, [])
+
+    return depths, unknown
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--name", required=True)
+    parser.add_argument("--mem", required=True)
+    parser.add_argument("--lib-stack", type=int, default=8,
+                        help="bytes charged to each SDCC library call")
+    for budget in ("code", "data", "idata", "xdata", "stack"):
+        parser.add_argument("--" + budget, type=int)
+    parser.add_argument("asm", nargs="+")
+    args = parser.parse_args()
+
+    code, xdata, data, idata, stack_free = read_mem(args.mem)
+    functions, address_taken = read_asm(args.asm)
+
+    if "_main" not in functions:
+        sys.exit("size_report: no main in %s" % " ".join(args.asm))
+
+    depths, unknown = stack_depths(functions, address_taken, args.lib_stack)
+
+    # main is entered by a jump from the startup code, with nothing pushed
+    isrs = sorted((depths[n] + 2 for n in functions if functions[n]["isr"]),
+                  reverse=True)
+    stack = depths["_main"] + sum(isrs[:2])
+
+    used = {"code": code, "data": data, "idata": idata, "xdata": xdata,
+            "stack": stack}
+    failed = False
+
+    print("%s:" % args.name)
+
+    for key in ("code", "data", "idata", "xdata", "stack"):
+        budget = getattr(args, key)
+        line = "  %-6s %6d bytes" % (key.upper(), used[key])
+
+        if budget is not None:
+            line += "  of %6d  (%3d%%)" % (budget, 100 * used[key] // budget if budget else 0)
+            if used[key] > budget:
+                line += "  OVER BUDGET"
+                failed = True
+
+        print(line)
+
+    print("         stack: main %d, deepest interrupts %s, %d library calls "
+          "at %d bytes each" % (depths["_main"], "+".join(str(d) for d in isrs[:2]) or "none",
+                                 len(unknown), args.lib_stack))
+
+    if stack_free is not None and stack > stack_free:
+        print("  stack needs %d bytes but only %d are free above the variables" %
+              (stack, stack_free))
+        failed = True
+
+    if failed:
+        sys.exit("size_report: %s is over budget" % args.name)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())